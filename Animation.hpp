@@ -37,6 +37,7 @@ namespace sfext
 		Animation(const Animation & rhs) : m_spriteSheet(rhs.m_spriteSheet), m_start(rhs.m_start), m_dimensions(rhs.m_dimensions), m_offset(rhs.m_offset), m_frameDistribution(rhs.m_frameDistribution), m_timer(rhs.m_timer), m_fps(rhs.m_fps)
 		{
 		}
+		Animation & operator = (const Animation &) = default;
 		// Destructor
 		~Animation()
 		{
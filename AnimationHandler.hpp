@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <map>
 #include <string>
 
@@ -9,12 +10,20 @@
 
 #include "SpriteHandler.hpp"
 #include "Animation.hpp"
+#include "Culling.hpp"
 
 // The AnimationHandler class provides a convenient way of storing and accessing Animations.
 
 // Animations are stored in a map of Animation names to Animations. Resources that are used
 // by the Animations such as Sprite Sheets and their associated Textures are also stored.
 
+// Sprite sheets can be packed into the TextureHandler's atlas like any other texture. The start of an animation is
+// always given relative to its own sheet, and frames are looked up in the atlas page automatically. loadAtlas creates
+// the animations of an atlas that was baked ahead of time from the frame layouts in its manifest.
+
+// Batches only contain the frames that touch the target's current view, so drawing a large map
+// does not generate vertices for the parts of it that are off screen.
+
 // TODO: documentation
 // TODO: testing
 // TODO: make it easier to interface with the LightMap class
@@ -61,7 +70,7 @@ namespace sfext
 		sf::Vector2f        getStart         (const sf::String & alias) const
 		{
 			if (hasAnimation(alias))
-				return m_animations.at(alias).getStart();
+				return m_animations.at(alias).getStart() - sheetOrigin(alias);
 			else
 				throw std::invalid_argument("The animation <" + alias + "> does not exist.");
 		}
@@ -108,6 +117,11 @@ namespace sfext
 				throw std::invalid_argument("The animation <" + alias + "> does not exist.");
 		}
 		// Mutators
+		void setAtlasMode(bool atlasMode)
+		{
+			// Pack the sprite sheets that are added from now on into the texture handler's atlas
+			m_sprites.setAtlasMode(atlasMode);
+		}
 		void setFPS     (const sf::String & alias, float fps)
 		{
 			if (hasAnimation(alias))
@@ -118,14 +132,14 @@ namespace sfext
 		void setStart   (const sf::String & alias, const sf::Vector2f & start)
 		{
 			if (hasAnimation(alias))
-				m_animations.at(alias).setStart(start);
+				m_animations.at(alias).setStart(start + sheetOrigin(alias));
 			else
 				throw std::invalid_argument("The animation <" + alias + "> does not exist.");
 		}
 		void setStart   (const sf::String & alias, float x, float y)
 		{
 			if (hasAnimation(alias))
-				m_animations.at(alias).setStart(x, y);
+				m_animations.at(alias).setStart(sf::Vector2f(x, y) + sheetOrigin(alias));
 			else
 				throw std::invalid_argument("The animation <" + alias + "> does not exist.");
 		}
@@ -148,7 +162,7 @@ namespace sfext
 		{
 			if (m_sprites.addTexture(filePath, alias))
 			{
-				m_animations[alias] = Animation(m_sprites.find(alias)->second, start, dimensions, offset, rowsAndColumns, fps);
+				m_animations[alias] = Animation(m_sprites.find(alias)->second, start + sheetOrigin(alias), dimensions, offset, rowsAndColumns, fps);
 				return true;
 			}
 			return false;
@@ -157,11 +171,38 @@ namespace sfext
 		{
 			if (m_sprites.addTexture(image, alias))
 			{
-				m_animations[alias] = Animation(m_sprites.find(alias)->second, start, dimensions, offset, rowsAndColumns, fps);
+				m_animations[alias] = Animation(m_sprites.find(alias)->second, start + sheetOrigin(alias), dimensions, offset, rowsAndColumns, fps);
+				return true;
+			}
+			return false;
+		}
+		bool addAnimation   (const sf::Image & image, std::uint64_t imageHash, const sf::String & alias, const sf::Vector2f & start, const sf::Vector2f & dimensions, const sf::Vector2f & offset, const sf::Vector2u & rowsAndColumns, float fps = 24.f)
+		{
+			// Same as above, with the hash of the image already found by TextureStore::hashImage
+			if (m_sprites.addTexture(image, imageHash, alias))
+			{
+				m_animations[alias] = Animation(m_sprites.find(alias)->second, start + sheetOrigin(alias), dimensions, offset, rowsAndColumns, fps);
 				return true;
 			}
 			return false;
 		}
+		bool loadAtlas      (const sf::String & manifestPath)
+		{
+			// Load a manifest written by AtlasBaker and create an animation for every alias that has a frame layout
+			AtlasManifest manifest;
+			return manifest.loadFromFile(manifestPath) && loadAtlas(manifest);
+		}
+		bool loadAtlas      (const AtlasManifest & manifest)
+		{
+			bool loaded = m_sprites.loadAtlas(manifest);
+			for (ConstAtlasManifestIterator entry = manifest.cbegin(); entry != manifest.cend(); ++entry)
+			{
+				const AtlasFrameLayout & layout = entry->second.layout;
+				if (entry->second.animated && m_sprites.getTextureHandler().isInAtlas(entry->first))
+					m_animations[entry->first] = Animation(m_sprites.find(entry->first)->second, layout.start + sheetOrigin(entry->first), layout.dimensions, layout.offset, layout.rowsAndColumns, layout.fps);
+			}
+			return loaded;
+		}
 		bool hasAnimation   (const sf::String & alias) const
 		{
 			return m_animations.find(alias) != m_animations.cend();
@@ -224,8 +265,11 @@ namespace sfext
 			{
 				sf::IntRect rectangle = m_animations.at(alias).currentTextureRect();
 				sf::VertexArray vertices(sf::Quads);
+				sf::FloatRect visibleBounds = getVisibleBounds(target, states);
 				for (const sf::Vector2f & position : positions)
 				{
+					if (!isVisible(visibleBounds, position, sf::Vector2f(static_cast<float>(rectangle.width), static_cast<float>(rectangle.height))))
+						continue;
 					vertices.append(sf::Vertex(position, sf::Vector2f(static_cast<float>(rectangle.left), static_cast<float>(rectangle.top))));
 					vertices.append(sf::Vertex(position + sf::Vector2f(static_cast<float>(rectangle.width), 0.f), sf::Vector2f(static_cast<float>(rectangle.left + rectangle.width), static_cast<float>(rectangle.top))));
 					vertices.append(sf::Vertex(position + sf::Vector2f(static_cast<float>(rectangle.width), static_cast<float>(rectangle.height)), sf::Vector2f(static_cast<float>(rectangle.left + rectangle.width), static_cast<float>(rectangle.top + rectangle.height))));
@@ -243,8 +287,11 @@ namespace sfext
 			{
 				sf::IntRect rectangle = m_animations.at(alias).currentTextureRect(frame);
 				sf::VertexArray vertices(sf::Quads);
+				sf::FloatRect visibleBounds = getVisibleBounds(target, states);
 				for (const sf::Vector2f & position : positions)
 				{
+					if (!isVisible(visibleBounds, position, sf::Vector2f(static_cast<float>(rectangle.width), static_cast<float>(rectangle.height))))
+						continue;
 					vertices.append(sf::Vertex(position, sf::Vector2f(static_cast<float>(rectangle.left), static_cast<float>(rectangle.top))));
 					vertices.append(sf::Vertex(position + sf::Vector2f(static_cast<float>(rectangle.width), 0.f), sf::Vector2f(static_cast<float>(rectangle.left + rectangle.width), static_cast<float>(rectangle.top))));
 					vertices.append(sf::Vertex(position + sf::Vector2f(static_cast<float>(rectangle.width), static_cast<float>(rectangle.height)), sf::Vector2f(static_cast<float>(rectangle.left + rectangle.width), static_cast<float>(rectangle.top + rectangle.height))));
@@ -262,8 +309,11 @@ namespace sfext
 			{
 				sf::IntRect rectangle = m_animations.at(alias).currentTextureRect(time);
 				sf::VertexArray vertices(sf::Quads);
+				sf::FloatRect visibleBounds = getVisibleBounds(target, states);
 				for (const sf::Vector2f & position : positions)
 				{
+					if (!isVisible(visibleBounds, position, sf::Vector2f(static_cast<float>(rectangle.width), static_cast<float>(rectangle.height))))
+						continue;
 					vertices.append(sf::Vertex(position, sf::Vector2f(static_cast<float>(rectangle.left), static_cast<float>(rectangle.top))));
 					vertices.append(sf::Vertex(position + sf::Vector2f(static_cast<float>(rectangle.width), 0.f), sf::Vector2f(static_cast<float>(rectangle.left + rectangle.width), static_cast<float>(rectangle.top))));
 					vertices.append(sf::Vertex(position + sf::Vector2f(static_cast<float>(rectangle.width), static_cast<float>(rectangle.height)), sf::Vector2f(static_cast<float>(rectangle.left + rectangle.width), static_cast<float>(rectangle.top + rectangle.height))));
@@ -281,9 +331,12 @@ namespace sfext
 			{
 				sf::IntRect rectangle;
 				sf::VertexArray vertices(sf::Quads);
+				sf::FloatRect visibleBounds = getVisibleBounds(target, states);
 				for (unsigned int i = 0; i < positions.size(); ++i)
 				{
 					rectangle = m_animations.at(alias).currentTextureRect(frames.at(i));
+					if (!isVisible(visibleBounds, positions.at(i), sf::Vector2f(static_cast<float>(rectangle.width), static_cast<float>(rectangle.height))))
+						continue;
 					vertices.append(sf::Vertex(positions.at(i), sf::Vector2f(static_cast<float>(rectangle.left), static_cast<float>(rectangle.top))));
 					vertices.append(sf::Vertex(positions.at(i) + sf::Vector2f(static_cast<float>(rectangle.width), 0.f), sf::Vector2f(static_cast<float>(rectangle.left + rectangle.width), static_cast<float>(rectangle.top))));
 					vertices.append(sf::Vertex(positions.at(i) + sf::Vector2f(static_cast<float>(rectangle.width), static_cast<float>(rectangle.height)), sf::Vector2f(static_cast<float>(rectangle.left + rectangle.width), static_cast<float>(rectangle.top + rectangle.height))));
@@ -301,9 +354,12 @@ namespace sfext
 			{
 				sf::IntRect rectangle;
 				sf::VertexArray vertices(sf::Quads);
+				sf::FloatRect visibleBounds = getVisibleBounds(target, states);
 				for (unsigned int i = 0; i < positions.size(); ++i)
 				{
 					rectangle = m_animations.at(alias).currentTextureRect(times.at(i));
+					if (!isVisible(visibleBounds, positions.at(i), sf::Vector2f(static_cast<float>(rectangle.width), static_cast<float>(rectangle.height))))
+						continue;
 					vertices.append(sf::Vertex(positions.at(i), sf::Vector2f(static_cast<float>(rectangle.left), static_cast<float>(rectangle.top))));
 					vertices.append(sf::Vertex(positions.at(i) + sf::Vector2f(static_cast<float>(rectangle.width), 0.f), sf::Vector2f(static_cast<float>(rectangle.left + rectangle.width), static_cast<float>(rectangle.top))));
 					vertices.append(sf::Vertex(positions.at(i) + sf::Vector2f(static_cast<float>(rectangle.width), static_cast<float>(rectangle.height)), sf::Vector2f(static_cast<float>(rectangle.left + rectangle.width), static_cast<float>(rectangle.top + rectangle.height))));
@@ -356,5 +412,13 @@ namespace sfext
 		{
 			return m_animations.find(alias);
 		}
+	private:
+		sf::Vector2f sheetOrigin(const sf::String & alias) const
+		{
+			// Returns where the alias's sprite sheet starts in its texture, which is only non-zero if it is in the atlas
+			// Animation frames are stored relative to the texture, but the handler's interface is relative to the sheet
+			sf::IntRect sheet = m_sprites.getTextureHandler().getTextureRect(alias);
+			return sf::Vector2f(static_cast<float>(sheet.left), static_cast<float>(sheet.top));
+		}
 	};
 }
\ No newline at end of file
@@ -0,0 +1,287 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <SFML/Graphics/Image.hpp>
+#include <SFML/Graphics/Rect.hpp>
+#include <SFML/System/Clock.hpp>
+#include <SFML/System/String.hpp>
+#include <SFML/System/Time.hpp>
+
+#include "AnimationHandler.hpp"
+#include "FontHandler.hpp"
+#include "TextureHandler.hpp"
+#include "TextureStore.hpp"
+
+// The AsyncLoader class loads textures, fonts and animations in the background, so that a loading screen can keep
+// drawing while a level's resources come in.
+
+// Loading is split in two. Reading and decoding files, which is the slow part, happens on the loader's own worker
+// threads, along with hashing the decoded images for the TextureStore. Adding the result to a handler creates OpenGL
+// textures, so it has to happen on the thread that owns the context: that is done by update, which the render thread
+// should call once per frame. update can be given a time budget so that a frame never spends more than that on uploads.
+
+// Every load returns a std::future that becomes ready once the resource has been added to its handler (or has failed
+// to load). Waiting on such a future from the render thread without calling update in between never returns.
+// Requests are decoded in the order they were made, several at a time, and added to their handlers in the order that
+// decoding finishes. The handlers must outlive the loader, and must not be used from other threads in the meantime;
+// the workers never touch them.
+
+// Destroying the loader lets the workers finish the files they are decoding and abandons everything else, whose
+// futures then report std::future_errc::broken_promise.
+
+// TODO: tests
+
+namespace sfext
+{
+	class AsyncLoader final
+	{
+	private:
+		struct HashedImage
+		{
+			sf::Image image;
+			std::uint64_t hash; // TextureStore::hashImage of the image, so that the render thread does not have to find it
+
+			bool load(const sf::String & filePath)
+			{
+				if (!image.loadFromFile(filePath))
+					return false;
+				hash = TextureStore::hashImage(image);
+				return true;
+			}
+		};
+
+		struct Request
+		{
+			std::function<bool()> decode; // Runs on a worker thread
+			std::function<bool()> upload; // Runs on the render thread, if decode succeeded
+			std::promise<bool> promise;
+			bool decoded;
+		};
+
+		std::vector<std::thread> m_threads;
+		mutable std::mutex m_mutex;
+		std::condition_variable m_wake;
+		std::condition_variable m_ready;
+		std::deque<std::shared_ptr<Request>> m_queued;
+		std::deque<std::shared_ptr<Request>> m_decoded;
+		std::size_t m_requested;
+		std::size_t m_decoding;
+		std::size_t m_finished;
+		std::size_t m_failed;
+		bool m_stopping;
+	public:
+		// Constructors
+		explicit AsyncLoader(unsigned int threads = 2) : m_requested(0), m_decoding(0), m_finished(0), m_failed(0), m_stopping(false)
+		{
+			for (unsigned int i = 0; i < std::max(threads, 1u); ++i)
+				m_threads.emplace_back([this]() { work(); });
+		}
+		AsyncLoader(const AsyncLoader &) = delete;
+		AsyncLoader & operator = (const AsyncLoader &) = delete;
+		// Destructor
+		~AsyncLoader()
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_stopping = true;
+				m_queued.clear();
+			}
+			m_wake.notify_all();
+			for (std::thread & thread : m_threads)
+				thread.join();
+		}
+		// Accessors
+		std::size_t getRequestedCount() const
+		{
+			// Returns the number of loads that have been requested since the loader was created or last reset
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_requested;
+		}
+		std::size_t getFinishedCount () const
+		{
+			// Returns the number of requested loads that have been added to their handlers or have failed
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_finished;
+		}
+		std::size_t getFailedCount   () const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_failed;
+		}
+		float       getProgress      () const
+		{
+			// Returns the fraction of the requested loads that have finished, which is 1 when nothing was requested
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_requested ? static_cast<float>(m_finished) / static_cast<float>(m_requested) : 1.f;
+		}
+		bool        isDone           () const
+		{
+			// Returns true once every requested load has finished
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_finished == m_requested;
+		}
+		// Mutators
+		void resetProgress()
+		{
+			// Start counting progress from zero, e.g. at the start of the next loading screen
+			// Loads that have not finished yet are counted again
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_requested -= m_finished;
+			m_finished = 0;
+			m_failed = 0;
+		}
+		// Utilities
+		std::future<bool> loadTexture  (TextureHandler & handler, const sf::String & filePath, const sf::String & alias, const sf::IntRect & area = sf::IntRect())
+		{
+			// Decode an image in the background and add it with handler.addTexture(image, alias, area)
+			std::shared_ptr<HashedImage> image = std::make_shared<HashedImage>();
+			return request([image, filePath]() { return image->load(filePath); },
+			               [image, &handler, alias, area]() { return handler.addTexture(image->image, image->hash, alias, area); });
+		}
+		std::future<bool> loadTexture  (TextureHandler & handler, const sf::String & filePath, const sf::String & alias, bool smooth, bool repeated, const sf::IntRect & area = sf::IntRect())
+		{
+			// Decode an image in the background and add it with handler.addTexture(image, alias, smooth, repeated, area)
+			std::shared_ptr<HashedImage> image = std::make_shared<HashedImage>();
+			return request([image, filePath]() { return image->load(filePath); },
+			               [image, &handler, alias, smooth, repeated, area]() { return handler.addTexture(image->image, image->hash, alias, smooth, repeated, area); });
+		}
+		std::future<bool> loadFont     (FontHandler & handler, const sf::String & filePath, const sf::String & fontAlias)
+		{
+			// Read a font file in the background and add it with handler.addFont(fileData, fontAlias)
+			std::shared_ptr<std::vector<char>> data = std::make_shared<std::vector<char>>();
+			return request([data, filePath]()
+			{
+				std::ifstream file(filePath.toAnsiString(), std::ios::binary);
+				if (!file)
+					return false;
+				data->assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+				return !data->empty();
+			},
+			[data, &handler, fontAlias]() { return handler.addFont(std::shared_ptr<const std::vector<char>>(data), fontAlias); });
+		}
+		std::future<bool> loadAnimation(AnimationHandler & handler, const sf::String & filePath, const sf::String & alias, const sf::Vector2f & start, const sf::Vector2f & dimensions, const sf::Vector2f & offset, const sf::Vector2u & rowsAndColumns, float fps = 24.f)
+		{
+			// Decode a sprite sheet in the background and add it with handler.addAnimation(image, alias, ...)
+			std::shared_ptr<HashedImage> image = std::make_shared<HashedImage>();
+			return request([image, filePath]() { return image->load(filePath); },
+			               [image, &handler, alias, start, dimensions, offset, rowsAndColumns, fps]() { return handler.addAnimation(image->image, image->hash, alias, start, dimensions, offset, rowsAndColumns, fps); });
+		}
+		std::size_t       update       (sf::Time budget = sf::Time::Zero)
+		{
+			// Add decoded resources to their handlers, on the thread that owns the OpenGL context
+			// With a budget, stops once the budget has been used up, but always adds at least one resource if any is ready
+			// Returns the number of loads that finished
+			sf::Clock clock;
+			std::size_t finished = 0;
+			while (budget <= sf::Time::Zero || finished == 0 || clock.getElapsedTime() < budget)
+			{
+				std::shared_ptr<Request> request;
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					if (m_decoded.empty())
+						break;
+					request = m_decoded.front();
+					m_decoded.pop_front();
+				}
+				bool loaded = false;
+				try
+				{
+					loaded = request->decoded && request->upload();
+				}
+				catch (...)
+				{
+					// A handler that throws (e.g. when out of memory) fails its own load, and the rest keep coming in
+				}
+				request->decode = nullptr;
+				request->upload = nullptr; // Frees the decoded data, which the handler has copied by now
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					++m_finished;
+					if (!loaded)
+						++m_failed;
+				}
+				request->promise.set_value(loaded);
+				++finished;
+			}
+			return finished;
+		}
+		void              finish       ()
+		{
+			// Block until every requested load has been decoded, adding each one to its handler as soon as it is ready
+			// Like update, this must be called on the thread that owns the OpenGL context
+			while (true)
+			{
+				{
+					std::unique_lock<std::mutex> lock(m_mutex);
+					m_ready.wait(lock, [this]() { return !m_decoded.empty() || (m_queued.empty() && m_decoding == 0); });
+					if (m_decoded.empty())
+						return;
+				}
+				update();
+			}
+		}
+	private:
+		std::future<bool> request(std::function<bool()> decode, std::function<bool()> upload)
+		{
+			// Queue a load for the workers
+			std::shared_ptr<Request> request = std::make_shared<Request>();
+			request->decode = std::move(decode);
+			request->upload = std::move(upload);
+			request->decoded = false;
+			std::future<bool> future = request->promise.get_future();
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_queued.push_back(request);
+				++m_requested;
+			}
+			m_wake.notify_one();
+			return future;
+		}
+		void work()
+		{
+			// Worker thread loop: decode queued requests and hand them over to update
+			while (true)
+			{
+				std::shared_ptr<Request> request;
+				{
+					std::unique_lock<std::mutex> lock(m_mutex);
+					m_wake.wait(lock, [this]() { return m_stopping || !m_queued.empty(); });
+					if (m_stopping)
+						return;
+					request = m_queued.front();
+					m_queued.pop_front();
+					++m_decoding;
+				}
+				bool decoded = false;
+				try
+				{
+					decoded = request->decode();
+				}
+				catch (...)
+				{
+					// A file that cannot be decoded (or does not fit in memory) fails its own load, not the worker
+				}
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					request->decoded = decoded;
+					m_decoded.push_back(request);
+					--m_decoding;
+				}
+				m_ready.notify_all();
+			}
+		}
+	};
+}
@@ -0,0 +1,119 @@
+// Offline texture atlas baker
+// Usage: AtlasBaker [--page-size N] [--padding N] [--layouts file] <image directory> <manifest>
+// Packs every image under the directory into PNG pages next to the manifest, and writes the binary AtlasManifest
+// Aliases are the paths of the images relative to the directory, with forward slashes and without the extension
+// The layouts file is an SML file with a variable for every alias that is an animation, for example
+//     var_begin:characters/hero
+//         start:0,0
+//         dimensions:32,48
+//         offset:0,0
+//         grid:4,6
+//         fps:12
+//     var_end
+// where grid is the number of rows and columns, as in AnimationHandler::addAnimation
+// Requires C++17 for std::filesystem
+
+#include "AtlasBaker.hpp"
+#include "SML.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	bool isImageFile(const std::filesystem::path & path)
+	{
+		// Returns true for the file types that sf::Image can load
+		std::string extension = path.extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		for (const char * supported : { ".png", ".jpg", ".jpeg", ".bmp", ".tga", ".gif", ".psd", ".hdr", ".pic" })
+		{
+			if (extension == supported)
+				return true;
+		}
+		return false;
+	}
+}
+
+int main(int argc, char * argv[])
+{
+	unsigned int pageSize = 2048;
+	unsigned int padding = 1;
+	std::string layouts;
+	std::vector<std::string> paths;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--page-size") == 0 && i + 1 < argc)
+			pageSize = static_cast<unsigned int>(std::stoul(argv[++i]));
+		else if (std::strcmp(argv[i], "--padding") == 0 && i + 1 < argc)
+			padding = static_cast<unsigned int>(std::stoul(argv[++i]));
+		else if (std::strcmp(argv[i], "--layouts") == 0 && i + 1 < argc)
+			layouts = argv[++i];
+		else
+			paths.push_back(argv[i]);
+	}
+	if (paths.size() != 2)
+	{
+		std::cerr << "Usage: AtlasBaker [--page-size N] [--padding N] [--layouts file] <image directory> <manifest>" << std::endl;
+		return 2;
+	}
+
+	std::error_code error;
+	std::filesystem::path directory(paths[0]);
+	std::vector<std::filesystem::path> files;
+	for (std::filesystem::recursive_directory_iterator entry(directory, error), end; !error && entry != end; entry.increment(error))
+	{
+		if (entry->is_regular_file() && isImageFile(entry->path()))
+			files.push_back(entry->path());
+	}
+	if (error)
+	{
+		std::cerr << "Cannot read " << paths[0] << ": " << error.message() << std::endl;
+		return 1;
+	}
+	std::sort(files.begin(), files.end()); // Directory order is unspecified, and the output should not depend on it
+
+	sfext::AtlasBaker baker(pageSize, padding);
+	bool failed = false;
+	for (const std::filesystem::path & file : files)
+	{
+		std::string alias = file.lexically_relative(directory).replace_extension().generic_string();
+		if (baker.hasImage(alias))
+		{
+			std::cerr << "Skipping " << file.string() << ": the alias <" << alias << "> is already taken" << std::endl;
+			continue;
+		}
+		if (!baker.addImage(alias, file.string()))
+		{
+			std::cerr << "Cannot add " << file.string() << ": it could not be loaded or is larger than a page" << std::endl;
+			failed = true;
+		}
+	}
+
+	if (!layouts.empty())
+	{
+		sfext::SML sml(layouts);
+		for (const sf::String & alias : sml.getValueNames())
+		{
+			sf::Vector2u grid = sml.interpretAsVector2<unsigned int>(alias, "grid");
+			sfext::AtlasFrameLayout layout{ sml.interpretAsVector2<float>(alias, "start"), sml.interpretAsVector2<float>(alias, "dimensions"), sml.interpretAsVector2<float>(alias, "offset"), grid,
+			                                sml.hasTag(alias, "fps") ? sml.interpretAsNumber<float>(alias, "fps") : 24.f };
+			if (!baker.setLayout(alias, layout))
+				std::cerr << "Ignoring the layout of <" << alias.toAnsiString() << ">: there is no image with that alias" << std::endl;
+		}
+	}
+
+	sfext::AtlasManifest manifest;
+	if (!baker.bake(paths[1], manifest))
+	{
+		std::cerr << "Cannot write " << paths[1] << " or one of its pages" << std::endl;
+		return 1;
+	}
+	std::cout << "Packed " << manifest.getEntryCount() << " images into " << manifest.getPageCount() << " pages" << std::endl;
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <SFML/Graphics/Image.hpp>
+#include <SFML/Graphics/Rect.hpp>
+#include <SFML/System/String.hpp>
+
+#include "AtlasManifest.hpp"
+#include "SkylinePacker.hpp"
+
+// The AtlasBaker class packs a set of images into atlas pages ahead of time and writes them out with an AtlasManifest.
+
+// Baking is done entirely with sf::Image, so it needs no window or graphics context and can run on a build machine.
+// Since packing is not done at startup, images are sorted tallest first before they are placed, which packs a
+// skyline noticeably tighter than placing them in the order they were added. Each page is trimmed to the area that
+// was actually used, so the last page is usually smaller than the rest.
+
+// TextureHandler::loadAtlas, SpriteHandler::loadAtlas and AnimationHandler::loadAtlas read the result.
+
+// TODO: tests
+
+namespace sfext
+{
+	class AtlasBaker final
+	{
+	private:
+		struct BakedImage
+		{
+			sf::Image image;
+			bool animated;
+			AtlasFrameLayout layout;
+		};
+
+		std::map<sf::String, BakedImage> m_images;
+		unsigned int m_pageSize;
+		unsigned int m_padding;
+	public:
+		// Constructors
+		explicit AtlasBaker(unsigned int pageSize = 2048, unsigned int padding = 1) : m_pageSize(pageSize), m_padding(padding)
+		{
+		}
+		// Destructor
+		~AtlasBaker()
+		{
+		}
+		// Accessors
+		unsigned int getPageSize  () const
+		{
+			return m_pageSize;
+		}
+		unsigned int getPadding   () const
+		{
+			return m_padding;
+		}
+		std::size_t  getImageCount() const
+		{
+			return m_images.size();
+		}
+		bool         hasImage     (const sf::String & alias) const
+		{
+			return m_images.find(alias) != m_images.end();
+		}
+		// Mutators
+		bool setLayout(const sf::String & alias, const AtlasFrameLayout & layout)
+		{
+			// Mark an image as an animation with the given frame layout
+			// Returns false if no image has the alias
+			auto found = m_images.find(alias);
+			if (found == m_images.end())
+				return false;
+			found->second.animated = true;
+			found->second.layout = layout;
+			return true;
+		}
+		// Utilities
+		bool addImage(const sf::String & alias, const sf::Image & image)
+		{
+			// Add an image under an alias, replacing whatever the alias referred to
+			// Returns false if the image is empty or does not fit on a page
+			sf::Vector2u size = image.getSize();
+			if (size.x == 0 || size.y == 0 || size.x + m_padding > m_pageSize || size.y + m_padding > m_pageSize)
+				return false;
+			m_images[alias] = BakedImage{ image, false, AtlasFrameLayout{ sf::Vector2f(), sf::Vector2f(), sf::Vector2f(), sf::Vector2u(), 0.f } };
+			return true;
+		}
+		bool addImage(const sf::String & alias, const sf::String & filePath)
+		{
+			sf::Image image;
+			return image.loadFromFile(filePath) && addImage(alias, image);
+		}
+		bool bake    (const sf::String & manifestPath, AtlasManifest & manifest) const
+		{
+			// Pack every image, save the pages as PNG files next to the manifest and save the manifest
+			// Pages are named after the manifest, e.g. sprites.atlas is baked into sprites0.png, sprites1.png and so on
+			// Returns false if a file cannot be written
+			std::vector<const std::pair<const sf::String, BakedImage> *> order;
+			for (const auto & image : m_images)
+				order.push_back(&image);
+			std::stable_sort(order.begin(), order.end(), [](const std::pair<const sf::String, BakedImage> * lhs, const std::pair<const sf::String, BakedImage> * rhs)
+			{
+				// Tallest first, then widest first
+				sf::Vector2u left = lhs->second.image.getSize();
+				sf::Vector2u right = rhs->second.image.getSize();
+				return left.y != right.y ? left.y > right.y : left.x > right.x;
+			});
+			std::vector<SkylinePacker> packers;
+			std::vector<sf::Vector2u> extents;
+			std::vector<std::size_t> pages(order.size());
+			std::vector<sf::IntRect> rects(order.size());
+			int size = static_cast<int>(m_pageSize);
+			for (std::size_t i = 0; i < order.size(); ++i)
+			{
+				sf::Vector2u imageSize = order[i]->second.image.getSize();
+				int width = static_cast<int>(imageSize.x + m_padding);
+				int height = static_cast<int>(imageSize.y + m_padding);
+				std::size_t page = 0;
+				while (page < packers.size() && !packers[page].pack(width, height, rects[i]))
+					++page;
+				if (page == packers.size())
+				{
+					packers.emplace_back(size, size);
+					extents.emplace_back(0, 0);
+					packers.back().pack(width, height, rects[i]);
+				}
+				rects[i].width = static_cast<int>(imageSize.x);
+				rects[i].height = static_cast<int>(imageSize.y);
+				pages[i] = page;
+				extents[page].x = std::max(extents[page].x, static_cast<unsigned int>(rects[i].left + rects[i].width));
+				extents[page].y = std::max(extents[page].y, static_cast<unsigned int>(rects[i].top + rects[i].height));
+			}
+			std::string path = manifestPath.toAnsiString();
+			std::string::size_type separator = path.find_last_of("/\\");
+			std::string::size_type extension = path.find_last_of('.');
+			if (extension == std::string::npos || (separator != std::string::npos && extension < separator))
+				extension = path.size();
+			std::string directory = separator != std::string::npos ? path.substr(0, separator + 1) : std::string();
+			std::string name = path.substr(directory.size(), extension - directory.size());
+			manifest.clear();
+			for (std::size_t page = 0; page < packers.size(); ++page)
+			{
+				sf::Image pageImage;
+				pageImage.create(extents[page].x, extents[page].y, sf::Color::Transparent);
+				for (std::size_t i = 0; i < order.size(); ++i)
+				{
+					if (pages[i] == page)
+						pageImage.copy(order[i]->second.image, static_cast<unsigned int>(rects[i].left), static_cast<unsigned int>(rects[i].top));
+				}
+				std::string fileName = name + std::to_string(page) + ".png";
+				if (!pageImage.saveToFile(directory + fileName))
+					return false;
+				manifest.addPage(fileName);
+			}
+			for (std::size_t i = 0; i < order.size(); ++i)
+			{
+				if (order[i]->second.animated)
+					manifest.addEntry(order[i]->first, pages[i], rects[i], order[i]->second.layout);
+				else
+					manifest.addEntry(order[i]->first, pages[i], rects[i]);
+			}
+			return manifest.saveToFile(manifestPath);
+		}
+		bool bake    (const sf::String & manifestPath) const
+		{
+			AtlasManifest manifest;
+			return bake(manifestPath, manifest);
+		}
+	};
+}
@@ -0,0 +1,307 @@
+#pragma once
+
+#include <SFML/Config.hpp>
+#include <SFML/Graphics/Rect.hpp>
+#include <SFML/System/String.hpp>
+#include <SFML/System/Vector2.hpp>
+
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+// The AtlasManifest class describes a texture atlas that was packed ahead of time, e.g. by the AtlasBaker tool.
+
+// A manifest lists the image files of the atlas pages and, for every alias, the page and the rectangle of it that
+// the alias was packed into. Aliases that are animations also carry the frame layout that AnimationHandler needs
+// (start, frame dimensions, offset between frames, rows and columns, and frames per second), with the start relative
+// to the alias's own image, just like AnimationHandler::addAnimation expects it.
+
+// Manifests are stored in a small binary format, so loading one is a single read instead of parsing text. All numbers
+// are little-endian, strings are UTF-8 prefixed by their length in bytes:
+//     "SFXA", version (uint32), page count (uint32), page file names (string)...,
+//     entry count (uint32), entries...
+// where an entry is
+//     alias (string), page (uint32), left, top, width, height (int32), animated (uint8),
+//     and, if animated, start x, start y, width, height, offset x, offset y (float32), rows, columns (uint32), fps (float32)
+// Page file names are relative to the directory of the manifest.
+
+// TODO: tests
+
+namespace sfext
+{
+	struct AtlasFrameLayout
+	{
+		sf::Vector2f start;          // Top left corner of the first frame, relative to the alias's image
+		sf::Vector2f dimensions;     // Size of a single frame
+		sf::Vector2f offset;         // Space between neighbouring frames
+		sf::Vector2u rowsAndColumns; // Number of frames down and across the sheet
+		float        fps;            // Frames per second
+	};
+
+	struct AtlasManifestEntry
+	{
+		std::size_t      page;     // Index of the page that the alias was packed into
+		sf::IntRect      rect;     // Pixels of the page that the alias covers
+		bool             animated; // Whether layout holds a frame layout
+		AtlasFrameLayout layout;   // How the alias is split into frames, if it is an animation
+	};
+
+	typedef std::map<sf::String, AtlasManifestEntry>::const_iterator ConstAtlasManifestIterator;
+
+	class AtlasManifest final
+	{
+	private:
+		std::vector<sf::String> m_pages;
+		std::map<sf::String, AtlasManifestEntry> m_entries;
+		sf::String m_directory;
+	public:
+		// Constructors
+		AtlasManifest()
+		{
+		}
+		// Destructor
+		~AtlasManifest()
+		{
+		}
+		// Accessors
+		std::size_t                getPageCount () const
+		{
+			return m_pages.size();
+		}
+		const sf::String &         getPageFile  (std::size_t page) const
+		{
+			// Returns the file name of a page, relative to the manifest
+			return m_pages.at(page);
+		}
+		sf::String                 getPagePath  (std::size_t page) const
+		{
+			// Returns the file name of a page, relative to the working directory if the manifest was loaded from a file
+			return m_directory + m_pages.at(page);
+		}
+		std::size_t                getEntryCount() const
+		{
+			return m_entries.size();
+		}
+		const AtlasManifestEntry * getEntry     (const sf::String & alias) const
+		{
+			// Returns where an alias was packed, or nullptr if it is not in the manifest
+			auto found = m_entries.find(alias);
+			return found != m_entries.end() ? &found->second : nullptr;
+		}
+		bool                       hasEntry     (const sf::String & alias) const
+		{
+			return m_entries.find(alias) != m_entries.end();
+		}
+		// Mutators
+		std::size_t addPage (const sf::String & fileName)
+		{
+			// Returns the index of the new page
+			m_pages.push_back(fileName);
+			return m_pages.size() - 1;
+		}
+		void        addEntry(const sf::String & alias, std::size_t page, const sf::IntRect & rect)
+		{
+			m_entries[alias] = AtlasManifestEntry{ page, rect, false, AtlasFrameLayout{ sf::Vector2f(), sf::Vector2f(), sf::Vector2f(), sf::Vector2u(), 0.f } };
+		}
+		void        addEntry(const sf::String & alias, std::size_t page, const sf::IntRect & rect, const AtlasFrameLayout & layout)
+		{
+			m_entries[alias] = AtlasManifestEntry{ page, rect, true, layout };
+		}
+		void        clear   ()
+		{
+			m_pages.clear();
+			m_entries.clear();
+			m_directory.clear();
+		}
+		// Utilities
+		bool loadFromFile  (const sf::String & filePath)
+		{
+			// Returns false, and leaves the manifest unchanged, if the file cannot be read or is not a valid manifest
+			std::ifstream file(filePath.toAnsiString(), std::ios::binary);
+			if (!file)
+				return false;
+			std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+			if (!loadFromMemory(data.data(), data.size()))
+				return false;
+			std::string path = filePath.toAnsiString();
+			std::string::size_type separator = path.find_last_of("/\\");
+			m_directory = separator != std::string::npos ? path.substr(0, separator + 1) : std::string();
+			return true;
+		}
+		bool loadFromMemory(const void * data, std::size_t size)
+		{
+			// Returns false, and leaves the manifest unchanged, if the data is not a valid manifest
+			Reader reader{ static_cast<const unsigned char *>(data), size, 0 };
+			sf::Uint32 version;
+			sf::Uint32 pageCount;
+			if (size < 4 || std::memcmp(data, "SFXA", 4) != 0)
+				return false;
+			reader.position = 4;
+			if (!reader.read(version) || version != 1 || !reader.read(pageCount))
+				return false;
+			std::vector<sf::String> pages;
+			for (sf::Uint32 i = 0; i < pageCount; ++i)
+			{
+				sf::String page;
+				if (!reader.read(page))
+					return false;
+				pages.push_back(page);
+			}
+			sf::Uint32 entryCount;
+			if (!reader.read(entryCount))
+				return false;
+			std::map<sf::String, AtlasManifestEntry> entries;
+			for (sf::Uint32 i = 0; i < entryCount; ++i)
+			{
+				sf::String alias;
+				sf::Uint32 page;
+				sf::Int32 left, top, width, height;
+				sf::Uint8 animated;
+				if (!reader.read(alias) || !reader.read(page) || !reader.read(left) || !reader.read(top) || !reader.read(width) || !reader.read(height) || !reader.read(animated))
+					return false;
+				if (page >= pageCount || animated > 1)
+					return false;
+				AtlasManifestEntry entry{ page, sf::IntRect(left, top, width, height), animated == 1, AtlasFrameLayout{ sf::Vector2f(), sf::Vector2f(), sf::Vector2f(), sf::Vector2u(), 0.f } };
+				if (entry.animated)
+				{
+					AtlasFrameLayout & layout = entry.layout;
+					if (!reader.read(layout.start.x) || !reader.read(layout.start.y) || !reader.read(layout.dimensions.x) || !reader.read(layout.dimensions.y) ||
+					    !reader.read(layout.offset.x) || !reader.read(layout.offset.y) || !reader.read(layout.rowsAndColumns.x) || !reader.read(layout.rowsAndColumns.y) ||
+					    !reader.read(layout.fps))
+						return false;
+				}
+				entries[alias] = entry;
+			}
+			m_pages.swap(pages);
+			m_entries.swap(entries);
+			m_directory.clear();
+			return true;
+		}
+		bool saveToFile    (const sf::String & filePath) const
+		{
+			std::vector<unsigned char> data(4);
+			std::memcpy(data.data(), "SFXA", 4);
+			write(data, sf::Uint32(1));
+			write(data, static_cast<sf::Uint32>(m_pages.size()));
+			for (const sf::String & page : m_pages)
+				write(data, page);
+			write(data, static_cast<sf::Uint32>(m_entries.size()));
+			for (const auto & entry : m_entries)
+			{
+				write(data, entry.first);
+				write(data, static_cast<sf::Uint32>(entry.second.page));
+				write(data, static_cast<sf::Int32>(entry.second.rect.left));
+				write(data, static_cast<sf::Int32>(entry.second.rect.top));
+				write(data, static_cast<sf::Int32>(entry.second.rect.width));
+				write(data, static_cast<sf::Int32>(entry.second.rect.height));
+				write(data, static_cast<sf::Uint8>(entry.second.animated ? 1 : 0));
+				if (entry.second.animated)
+				{
+					const AtlasFrameLayout & layout = entry.second.layout;
+					write(data, layout.start.x);
+					write(data, layout.start.y);
+					write(data, layout.dimensions.x);
+					write(data, layout.dimensions.y);
+					write(data, layout.offset.x);
+					write(data, layout.offset.y);
+					write(data, static_cast<sf::Uint32>(layout.rowsAndColumns.x));
+					write(data, static_cast<sf::Uint32>(layout.rowsAndColumns.y));
+					write(data, layout.fps);
+				}
+			}
+			std::ofstream file(filePath.toAnsiString(), std::ios::binary);
+			file.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size()));
+			return static_cast<bool>(file);
+		}
+		// Iterators
+		ConstAtlasManifestIterator cbegin() const
+		{
+			return m_entries.cbegin();
+		}
+		ConstAtlasManifestIterator cend  () const
+		{
+			return m_entries.cend();
+		}
+	private:
+		struct Reader
+		{
+			const unsigned char * data;
+			std::size_t size;
+			std::size_t position;
+
+			bool read(sf::Uint8 & value)
+			{
+				if (position + 1 > size)
+					return false;
+				value = data[position++];
+				return true;
+			}
+			bool read(sf::Uint32 & value)
+			{
+				if (position + 4 > size)
+					return false;
+				value = static_cast<sf::Uint32>(data[position]) | static_cast<sf::Uint32>(data[position + 1]) << 8 |
+				        static_cast<sf::Uint32>(data[position + 2]) << 16 | static_cast<sf::Uint32>(data[position + 3]) << 24;
+				position += 4;
+				return true;
+			}
+			bool read(sf::Int32 & value)
+			{
+				sf::Uint32 bits;
+				if (!read(bits))
+					return false;
+				std::memcpy(&value, &bits, 4);
+				return true;
+			}
+			bool read(float & value)
+			{
+				sf::Uint32 bits;
+				if (!read(bits))
+					return false;
+				std::memcpy(&value, &bits, 4);
+				return true;
+			}
+			bool read(sf::String & value)
+			{
+				sf::Uint32 length;
+				if (!read(length) || length > size - position)
+					return false;
+				value = sf::String::fromUtf8(data + position, data + position + length);
+				position += length;
+				return true;
+			}
+		};
+
+		static void write(std::vector<unsigned char> & data, sf::Uint8 value)
+		{
+			data.push_back(value);
+		}
+		static void write(std::vector<unsigned char> & data, sf::Uint32 value)
+		{
+			for (int shift = 0; shift < 32; shift += 8)
+				data.push_back(static_cast<unsigned char>(value >> shift));
+		}
+		static void write(std::vector<unsigned char> & data, sf::Int32 value)
+		{
+			sf::Uint32 bits;
+			std::memcpy(&bits, &value, 4);
+			write(data, bits);
+		}
+		static void write(std::vector<unsigned char> & data, float value)
+		{
+			sf::Uint32 bits;
+			std::memcpy(&bits, &value, 4);
+			write(data, bits);
+		}
+		static void write(std::vector<unsigned char> & data, const sf::String & value)
+		{
+			std::basic_string<sf::Uint8> utf8 = value.toUtf8();
+			write(data, static_cast<sf::Uint32>(utf8.size()));
+			data.insert(data.end(), utf8.begin(), utf8.end());
+		}
+	};
+}
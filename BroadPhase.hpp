@@ -0,0 +1,10 @@
+#pragma once
+
+namespace sfext
+{
+	enum class BroadPhase
+	{
+		SpatialHash, // Every mover looks up the entities around it in a uniform grid, best when few entities move at once
+		SweepAndPrune // Every overlapping pair is found at once by sorting the bounding boxes, best when most entities move
+	};
+}
@@ -3,6 +3,9 @@
 #include <SFML/System/Vector2.hpp>
 #include <SFML/Graphics/Rect.hpp>
 
+#include <algorithm>
+#include <limits>
+
 
 // TODO: tests
 
@@ -11,6 +14,10 @@
 
 // The functionalities that are provided include detecting intersections with other AABBs, movement, and resizing.
 
+// Moving AABBs can also be swept against each other: sweep finds the first moment at which an AABB moving along a
+// straight line touches another one, so fast objects can be stopped at a thin wall instead of passing through it
+// between two frames.
+
 // Intersection handling is beyond the scope of this class and is instead handled in the Entity class.
 
 namespace sfext
@@ -136,6 +143,40 @@ namespace sfext
 		{
 			return m_bounds.intersects(other.getBoundingBox(), intersection);
 		}
+		bool sweep        (const sf::Vector2f & displacement, const Collidable & other, float & time, sf::Vector2f & normal) const
+		{
+			// Move this AABB along displacement and find when it first hits the (stationary) other AABB
+			// Returns true if they touch while time goes from 0 to 1, in which case time is set to the fraction of the
+			// displacement that can be covered before contact, and normal to the side of 'other' that was hit
+			// If the AABBs already intersect at time 0, time is 0 and normal is (0, 0)
+			const sf::FloatRect & otherBounds = other.m_bounds;
+			if (m_bounds.intersects(otherBounds))
+			{
+				time = 0.f;
+				normal = sf::Vector2f(0.f, 0.f);
+				return true;
+			}
+			float entryX, exitX, entryY, exitY;
+			if (!sweepAxis(m_bounds.left, m_bounds.width, otherBounds.left, otherBounds.width, displacement.x, entryX, exitX))
+				return false;
+			if (!sweepAxis(m_bounds.top, m_bounds.height, otherBounds.top, otherBounds.height, displacement.y, entryY, exitY))
+				return false;
+			float entry = std::max(entryX, entryY);
+			float exit = std::min(exitX, exitY);
+			if (entry >= exit || entry < 0.f || entry > 1.f)
+				return false;
+			time = entry;
+			if (entryX > entryY)
+				normal = sf::Vector2f(displacement.x > 0.f ? -1.f : 1.f, 0.f);
+			else
+				normal = sf::Vector2f(0.f, displacement.y > 0.f ? -1.f : 1.f);
+			return true;
+		}
+		bool sweep        (const sf::Vector2f & displacement, const Collidable & other, float & time) const
+		{
+			sf::Vector2f normal;
+			return sweep(displacement, other, time, normal);
+		}
 		bool containsPoint(float x, float y) const
 		{
 			return m_bounds.contains(x, y);
@@ -144,5 +185,30 @@ namespace sfext
 		{
 			return m_bounds.contains(point);
 		}
+	private:
+		static bool sweepAxis(float position, float length, float otherPosition, float otherLength, float distance, float & entry, float & exit)
+		{
+			// Find when a moving interval starts and stops overlapping a stationary one along a single axis
+			// Returns false if they never overlap on this axis
+			if (distance == 0.f)
+			{
+				if (position + length <= otherPosition || otherPosition + otherLength <= position)
+					return false;
+				entry = -std::numeric_limits<float>::infinity();
+				exit = std::numeric_limits<float>::infinity();
+				return true;
+			}
+			if (distance > 0.f)
+			{
+				entry = (otherPosition - (position + length)) / distance;
+				exit = (otherPosition + otherLength - position) / distance;
+			}
+			else
+			{
+				entry = (otherPosition + otherLength - position) / distance;
+				exit = (otherPosition - (position + length)) / distance;
+			}
+			return true;
+		}
 	};
 }
\ No newline at end of file
@@ -0,0 +1,10 @@
+#pragma once
+
+namespace sfext
+{
+	enum class CollisionMode
+	{
+		Discrete, // Entities move freely and overlaps are fixed afterwards by handleIntersections
+		Continuous // Entities are swept along their movement and stopped at the first entity they would hit
+	};
+}
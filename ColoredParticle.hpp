@@ -3,6 +3,8 @@
 #pragma once
 
 #include "Particle.hpp"
+#include "ParticleBuffer.hpp"
+#include "ParticlePool.hpp"
 #include "Random.hpp"
 #include "VectorMath.hpp"
 
@@ -11,6 +13,11 @@
 #include <SFML\Graphics\Drawable.hpp>
 #include <SFML\Graphics\RenderTarget.hpp>
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
 // TODO: decide on where this class will go
 //		 will we keep this functionality or move it to the base particle class?
 
@@ -56,6 +63,10 @@ namespace sfext
 		{
 			vertices.append(sf::Vertex(m_vertex.position, m_vertex.color));
 		}
+		virtual void writeVertices(sf::Vertex * vertices, std::size_t) const
+		{
+			vertices[0] = sf::Vertex(m_vertex.position, m_vertex.color);
+		}
 	};
 
 
@@ -83,5 +94,73 @@ namespace sfext
 			ColoredParticle * particle = new ColoredParticle(position, velocity, m_lifespan, m_color);
 			return particle;
 		}
+		ColoredParticle * create(ParticlePool<ColoredParticle> & pool) const
+		{
+			// Creates a random particle in the same way as create(), but allocates it from a ParticlePool
+			// Returns nullptr if the pool is full
+			sf::Vector2f position = randomVector2fWithinCircle(m_position, m_radius);
+			sf::Vector2f velocity = distance(sf::Vector2f(0.f, 0.f), m_velocity) * unitVector(angle(position - m_position));
+			return pool.create(position, velocity, m_lifespan, m_color);
+		}
+		void              create(ParticleBuffer & particles) const
+		{
+			// Creates a random particle in the same way as create(), but writes it straight into a ParticleBuffer
+			// No memory is allocated for the particle itself
+			sf::Vector2f position = randomVector2fWithinCircle(m_position, m_radius);
+			sf::Vector2f velocity = distance(sf::Vector2f(0.f, 0.f), m_velocity) * unitVector(angle(position - m_position));
+			particles.add(position, velocity, m_lifespan, m_color);
+		}
+		// Batch Creator Functions
+		std::size_t       createBatch(std::size_t n, ParticlePool<ColoredParticle> & pool, std::vector<ColoredParticle *> & particles) const
+		{
+			// Creates n random particles in the same way as create(), allocating them from a ParticlePool and appending them to particles
+			// The random radii and angles are sampled a chunk at a time instead of one particle at a time
+			// Returns the number of particles that were created, which is less than n if the pool fills up
+			const std::size_t chunkSize = 256;
+			float radii[chunkSize];
+			float angles[chunkSize];
+			float speed = distance(sf::Vector2f(0.f, 0.f), m_velocity);
+			particles.reserve(particles.size() + std::min(n, pool.capacity() - std::min(pool.size(), pool.capacity())));
+			std::size_t created = 0;
+			while (created < n)
+			{
+				std::size_t count = std::min(n - created, chunkSize);
+				randomReals(radii, count, 0.f, m_radius);
+				randomReals(angles, count, 0.f, TWO_PI_F);
+				for (std::size_t i = 0; i < count; ++i)
+				{
+					sf::Vector2f direction(std::cos(angles[i]), std::sin(angles[i]));
+					ColoredParticle * particle = pool.create(m_position + radii[i] * direction, speed * direction, m_lifespan, m_color);
+					if (particle == nullptr)
+						return created;
+					particles.push_back(particle);
+					++created;
+				}
+			}
+			return created;
+		}
+		void              createBatch(std::size_t n, ParticleBuffer & particles) const
+		{
+			// Creates n random particles in the same way as create(), writing them straight into a ParticleBuffer
+			// The radii and angles are sampled into the position columns first and then turned into positions and
+			// velocities in a single pass, so no temporary memory is needed
+			ParticleColumns columns = particles.append(n);
+			randomReals(columns.positionX, n, 0.f, m_radius);
+			randomReals(columns.positionY, n, 0.f, TWO_PI_F);
+			float speed = distance(sf::Vector2f(0.f, 0.f), m_velocity);
+			float lifespan = m_lifespan.asSeconds();
+			for (std::size_t i = 0; i < n; ++i)
+			{
+				float radius = columns.positionX[i];
+				float cosine = std::cos(columns.positionY[i]);
+				float sine = std::sin(columns.positionY[i]);
+				columns.positionX[i] = m_position.x + radius * cosine;
+				columns.positionY[i] = m_position.y + radius * sine;
+				columns.velocityX[i] = speed * cosine;
+				columns.velocityY[i] = speed * sine;
+				columns.lifespan[i] = lifespan;
+				columns.color[i] = m_color;
+			}
+		}
 	};
 }
\ No newline at end of file
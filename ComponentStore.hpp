@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+// The ComponentStore class holds every component of one type in a contiguous array, as a sparse set.
+
+// Components are packed at the front of a dense array, next to a parallel array of the entities that own them, so a
+// system that needs only this type of component walks a plain array. A sparse array indexed by entity maps each entity
+// to its component, so checking for a component or finding it is a single lookup.
+
+// Removing a component moves the last component into its place, so the order of the dense array is not meaningful.
+
+// TODO: tests
+
+namespace sfext
+{
+	template <typename Component>
+	class ComponentStore final
+	{
+	private:
+		static const std::uint32_t NoComponent = std::numeric_limits<std::uint32_t>::max();
+
+		std::vector<Component> m_components;
+		std::vector<std::uint32_t> m_entities; // Entity that owns each component
+		std::vector<std::uint32_t> m_sparse; // Position of each entity's component, or NoComponent
+	public:
+		// Constructors
+		ComponentStore()
+		{
+		}
+		// Destructor
+		~ComponentStore()
+		{
+		}
+		// Accessors
+		std::size_t             size      () const
+		{
+			// Returns the number of components
+			return m_components.size();
+		}
+		bool                    has       (std::uint32_t entity) const
+		{
+			// Returns true if the entity has a component in this store
+			return entity < m_sparse.size() && m_sparse[entity] != NoComponent;
+		}
+		Component *             get       (std::uint32_t entity)
+		{
+			// Returns the entity's component, or nullptr if it does not have one
+			return has(entity) ? &m_components[m_sparse[entity]] : nullptr;
+		}
+		const Component *       get       (std::uint32_t entity) const
+		{
+			// Returns the entity's component, or nullptr if it does not have one
+			return has(entity) ? &m_components[m_sparse[entity]] : nullptr;
+		}
+		Component *             data      ()
+		{
+			// Returns the dense array of components
+			return m_components.data();
+		}
+		const Component *       data      () const
+		{
+			// Returns the dense array of components
+			return m_components.data();
+		}
+		const std::uint32_t *   entities  () const
+		{
+			// Returns the entity that owns each component in the dense array
+			return m_entities.data();
+		}
+		// Mutators
+		void        reserve(std::size_t count)
+		{
+			// Allocate room for count components up front
+			m_components.reserve(count);
+			m_entities.reserve(count);
+		}
+		Component & add    (std::uint32_t entity, Component component)
+		{
+			// Give an entity a component, replacing the one it already has
+			if (has(entity))
+				return m_components[m_sparse[entity]] = std::move(component);
+			if (entity >= m_sparse.size())
+				m_sparse.resize(entity + 1, static_cast<std::uint32_t>(NoComponent));
+			m_sparse[entity] = static_cast<std::uint32_t>(m_components.size());
+			m_components.push_back(std::move(component));
+			m_entities.push_back(entity);
+			return m_components.back();
+		}
+		bool        remove (std::uint32_t entity)
+		{
+			// Take an entity's component away, moving the last component into its place
+			// Returns false if the entity did not have one
+			if (!has(entity))
+				return false;
+			std::uint32_t index = m_sparse[entity];
+			std::uint32_t last = static_cast<std::uint32_t>(m_components.size() - 1);
+			if (index != last)
+			{
+				m_components[index] = std::move(m_components[last]);
+				m_entities[index] = m_entities[last];
+				m_sparse[m_entities[index]] = index;
+			}
+			m_components.pop_back();
+			m_entities.pop_back();
+			m_sparse[entity] = NoComponent;
+			return true;
+		}
+		void        clear  ()
+		{
+			// Remove every component
+			m_components.clear();
+			m_entities.clear();
+			m_sparse.clear();
+		}
+	};
+}
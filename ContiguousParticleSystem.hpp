@@ -0,0 +1,210 @@
+#pragma once
+
+#include "ParticleBuffer.hpp"
+#include "ParticleSorter.hpp"
+#include "VertexBatch.hpp"
+
+#include <SFML/Graphics/Drawable.hpp>
+#include <SFML/Graphics/RenderTarget.hpp>
+#include <functional>
+#include <vector>
+
+// The ContiguousParticleSystem is the structure-of-arrays counterpart to the ParticleSystem.
+
+// Instead of holding a pointer to each heap allocated particle, the particles are stored in a ParticleBuffer and are
+// updated column by column. The factory writes new particles straight into the buffer through
+// Factory::createBatch(std::size_t n, ParticleBuffer &), so spawning a burst of particles grows the buffer at most once
+// and never allocates a particle on its own.
+
+// Particles are drawn in the order they are stored in. Effects that need a particular order for blending, such as
+// layered smoke, can choose a sort key with setSorting. The particles are then kept sorted by step, which reorders the
+// buffer in place. Keys that rarely change order are cheap to keep sorted, but keys that moving particles overtake each
+// other on, like depth, cost a full radix sort every frame.
+
+// Particles in this system are drawn as colored points. Effects that need a custom Particle subclass should keep using
+// the ParticleSystem.
+
+// TODO: tests
+
+namespace sfext
+{
+	template <typename Factory>
+	class ContiguousParticleSystem final : public sf::Drawable
+	{
+	private:
+		ParticleBuffer m_particles;
+		Factory m_factory;
+		ParticleSortKey m_sortKey;
+		ParticleSortOrder m_sortOrder;
+		std::function<float(const ParticleBuffer &, std::size_t)> m_sortFunction;
+		ParticleSorter m_sorter;
+		std::vector<float> m_sortKeys;
+		mutable VertexBatch m_vertices;
+		mutable bool m_batched;
+	public:
+		// Constructors
+		ContiguousParticleSystem(const Factory & factory) : m_factory(factory), m_sortKey(ParticleSortKey::None), m_sortOrder(ParticleSortOrder::Ascending), m_vertices(sf::PrimitiveType::Points), m_batched(false)
+		{
+		}
+		ContiguousParticleSystem(const Factory & factory, std::size_t capacity) : m_particles(capacity), m_factory(factory), m_sortKey(ParticleSortKey::None), m_sortOrder(ParticleSortOrder::Ascending), m_vertices(sf::PrimitiveType::Points), m_batched(false)
+		{
+		}
+		// Destructor
+		~ContiguousParticleSystem()
+		{
+			// Nothing to do here, the buffer owns all of the particle data
+		}
+		// Accessors
+		const ParticleBuffer & getParticles() const
+		{
+			// Returns the underlying particle storage
+			return m_particles;
+		}
+		std::size_t            size        () const
+		{
+			// Returns the number of particles in the particle system
+			return m_particles.size();
+		}
+		ParticleSortKey        getSortKey  () const
+		{
+			// Returns what the particles are sorted by
+			return m_sortKey;
+		}
+		ParticleSortOrder      getSortOrder() const
+		{
+			// Returns the direction the particles are sorted in
+			return m_sortOrder;
+		}
+		const ParticleSorter & getSorter   () const
+		{
+			// Returns the sorter, which reports how the last sort was done
+			return m_sorter;
+		}
+		// Mutators
+		bool setKernelPath(ParticleKernelPath path)
+		{
+			// Choose which vectorized kernels are used to update the particles
+			return m_particles.setKernelPath(path);
+		}
+		void setSorting(ParticleSortKey key, ParticleSortOrder order = ParticleSortOrder::Ascending)
+		{
+			// Choose what the particles are sorted by before they are drawn
+			// ParticleSortKey::Custom keeps the key function that was last passed to the other overload
+			m_sortKey = key;
+			m_sortOrder = order;
+		}
+		void setSorting(const std::function<float(const ParticleBuffer &, std::size_t)> & key, ParticleSortOrder order = ParticleSortOrder::Ascending)
+		{
+			// Sort the particles by a custom key, which is called with the buffer and the index of each particle
+			m_sortKey = ParticleSortKey::Custom;
+			m_sortOrder = order;
+			m_sortFunction = key;
+		}
+		// Utilities
+		void move               (sf::Time elapsed)
+		{
+			// Update the position of each particle in the particle system
+			m_batched = false;
+			m_particles.move(elapsed);
+		}
+		void age                (sf::Time elapsed)
+		{
+			// Update the age of each particle in the particle system
+			m_batched = false;
+			m_particles.age(elapsed);
+		}
+		void accelerate         (const sf::Vector2f & direction, sf::Time elapsed)
+		{
+			// Update the velocity of each particle in the particle system
+			// Updates based on the current velocity and a force vector
+			m_batched = false;
+			m_particles.accelerate(direction, elapsed);
+		}
+		void deleteDeadParticles(ParticleCompaction compaction = ParticleCompaction::Stable)
+		{
+			// Remove particles that have ages that are greater than the particle's lifespan
+			m_batched = false;
+			m_particles.deleteDeadParticles(compaction);
+		}
+		void step               (sf::Time elapsed, const sf::Vector2f & force = sf::Vector2f(), ParticleCompaction compaction = ParticleCompaction::Stable)
+		{
+			// Accelerate, move, and age each particle and remove the dead ones in a single sweep
+			// The particles are then sorted if a sort key has been chosen
+			m_batched = false;
+			m_particles.step(elapsed, force, compaction);
+			sort();
+		}
+		void step               (sf::Time elapsed, const sf::Vector2f & force, WorkerPool & workers, ParticleCompaction compaction = ParticleCompaction::Stable)
+		{
+			// Integrate the particles on the worker threads, then remove the dead ones
+			m_batched = false;
+			m_particles.step(elapsed, force, workers, compaction);
+			sort();
+		}
+		void sort               ()
+		{
+			// Reorder the particles by the current sort key
+			// Does nothing if there is no sort key, or if the particles are already in order
+			const float * keys = nullptr;
+			switch (m_sortKey)
+			{
+			case ParticleSortKey::Age:
+				keys = m_particles.getAges();
+				break;
+			case ParticleSortKey::Depth:
+				keys = m_particles.getPositionsY();
+				break;
+			case ParticleSortKey::Custom:
+				if (!m_sortFunction)
+					return;
+				m_sortKeys.resize(m_particles.size());
+				for (std::size_t i = 0; i < m_sortKeys.size(); ++i)
+					m_sortKeys[i] = m_sortFunction(m_particles, i);
+				keys = m_sortKeys.data();
+				break;
+			default:
+				return;
+			}
+			if (m_sorter.sort(keys, m_particles.size(), m_sortOrder))
+			{
+				m_batched = false;
+				m_particles.reorder(m_sorter.getOrder());
+			}
+		}
+		void batch              (WorkerPool & workers)
+		{
+			// Write the particle vertices into the draw batch on the worker threads
+			// The next call to draw uses these vertices as long as the particles are not changed in the meantime
+			sf::Vertex * vertices = m_vertices.resize(m_particles.size());
+			if (vertices != nullptr)
+				m_particles.writeVertices(vertices, workers);
+			m_batched = true;
+		}
+		void draw               (sf::RenderTarget & target, sf::RenderStates states = sf::RenderStates::Default) const
+		{
+			// Draw the particles to the desired RenderTarget with a single call to draw
+			// The vertex array is kept between frames and is only resized when the particle count changes
+			if (!m_batched)
+			{
+				sf::Vertex * vertices = m_vertices.resize(m_particles.size());
+				if (vertices != nullptr)
+					m_particles.writeVertices(vertices);
+				m_batched = true;
+			}
+			target.draw(m_vertices, states);
+		}
+		bool setUseVertexBuffer(bool use)
+		{
+			// Opt in to streaming the particle vertices into a GPU resident sf::VertexBuffer
+			// Returns false if vertex buffers are not available
+			return m_vertices.setUseVertexBuffer(use);
+		}
+		// Factory functions
+		void add(unsigned int n)
+		{
+			// Add n new particles to the particle system
+			m_batched = false;
+			m_factory.createBatch(n, m_particles);
+		}
+	};
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <SFML/Graphics/Rect.hpp>
+#include <SFML/Graphics/RenderStates.hpp>
+#include <SFML/Graphics/RenderTarget.hpp>
+#include <SFML/Graphics/Transform.hpp>
+#include <SFML/Graphics/View.hpp>
+
+#include "VectorMath.hpp"
+
+#include <cmath>
+
+// The culling functions decide whether something that is about to be drawn can end up on screen.
+
+// The visible area is the axis-aligned bounding box of the target's current view. A rotated view is covered by a box
+// that is slightly too large, so culling never removes anything that is visible, it just keeps a little more than it
+// has to. The transform of the render states is undone on the visible area, so objects are tested in the same local
+// coordinates that their vertices are written in.
+
+// TODO: tests
+
+namespace sfext
+{
+	sf::FloatRect getViewBounds   (const sf::View & view)
+	{
+		// Returns the smallest axis-aligned rectangle that contains everything the view shows
+		float radians = degreesToRadians(view.getRotation());
+		float cosine = std::abs(std::cos(radians));
+		float sine = std::abs(std::sin(radians));
+		sf::Vector2f size = view.getSize();
+		sf::Vector2f extent((cosine * std::abs(size.x) + sine * std::abs(size.y)) / 2.f, (sine * std::abs(size.x) + cosine * std::abs(size.y)) / 2.f);
+		return sf::FloatRect(view.getCenter() - extent, 2.f * extent);
+	}
+	sf::FloatRect getVisibleBounds(const sf::RenderTarget & target, const sf::RenderStates & states = sf::RenderStates::Default)
+	{
+		// Returns the area of the target's current view, in the local coordinates of something drawn with states
+		return states.transform.getInverse().transformRect(getViewBounds(target.getView()));
+	}
+
+	bool isVisible(const sf::FloatRect & visibleBounds, const sf::FloatRect & bounds)
+	{
+		// Returns true if bounds touches the visible area
+		// Unlike sf::FloatRect::intersects, this also accepts rectangles with no area, such as points and lines
+		return bounds.left <= visibleBounds.left + visibleBounds.width && bounds.left + bounds.width >= visibleBounds.left &&
+		       bounds.top <= visibleBounds.top + visibleBounds.height && bounds.top + bounds.height >= visibleBounds.top;
+	}
+	bool isVisible(const sf::FloatRect & visibleBounds, const sf::Vector2f & position, const sf::Vector2f & size)
+	{
+		// Returns true if the rectangle at position with the given size touches the visible area
+		return isVisible(visibleBounds, sf::FloatRect(position, size));
+	}
+}
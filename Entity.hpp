@@ -13,6 +13,78 @@
 
 namespace sfext
 {
+	void resolveIntersection(Collidable & collidable, sf::Vector2f & velocity, const Collidable & other)
+	{
+		// Push an intersecting moving collidable back out of a static one along its velocity, and stop it on that axis
+		// This is the intersection response used by Entity::handleIntersection, so it makes the same assumptions:
+		// 'other' is static (terrain, boundaries, etc.) and the two collidables are known to intersect
+		if (velocity.x == 0.f)
+		{
+			if (velocity.y < 0.f) // Object is moving straight up
+			{
+				collidable.move(0.f, other.getPosition().y + other.getDimensions().y - collidable.getPosition().y);
+			}
+			else if (velocity.y > 0.f) // Object is moving straight down
+			{
+				collidable.move(0.f, other.getPosition().y - collidable.getPosition().y - collidable.getDimensions().y);
+			}
+			velocity.y = 0.f;
+			return;
+		}
+		else if (velocity.y == 0.f)
+		{
+			if (velocity.x < 0.f) // Object is moving straight to the left
+			{
+				collidable.move(other.getPosition().x + other.getDimensions().x - collidable.getPosition().x, 0.f);
+			}
+			else if (velocity.x > 0.f) // Object is moving straight to the right
+			{
+				collidable.move(other.getPosition().x - collidable.getPosition().x - collidable.getDimensions().x, 0.f);
+			}
+			velocity.x = 0.f;
+			return;
+		}
+		sf::Vector2f offset(0.f, 0.f);
+		sf::Vector2f ratios(0.f, 0.f);
+		if (velocity.x < 0.f && velocity.y < 0.f)
+		{
+			offset = collidable.getPosition() - other.getPosition() - other.getDimensions();
+			ratios = sf::Vector2f(offset.x / velocity.x, offset.y / velocity.y);
+		}
+		else if (velocity.x < 0.f && velocity.y > 0.f)
+		{
+			offset.x = collidable.getPosition().x - other.getPosition().x - other.getDimensions().x;
+			offset.y = collidable.getPosition().y + collidable.getDimensions().y - other.getPosition().y;
+			ratios = sf::Vector2f(offset.x / velocity.x, offset.y / velocity.y);
+		}
+		else if (velocity.x > 0.f && velocity.y < 0.f)
+		{
+			offset.x = collidable.getPosition().x + collidable.getDimensions().x - other.getPosition().x;
+			offset.y = collidable.getPosition().y - other.getPosition().y - other.getDimensions().y;
+			ratios = sf::Vector2f(offset.x / velocity.x, offset.y / velocity.y);
+		}
+		else if (velocity.x > 0.f && velocity.y > 0.f)
+		{
+			offset = collidable.getPosition() + collidable.getDimensions() - other.getPosition();
+			ratios = sf::Vector2f(offset.x / velocity.x, offset.y / velocity.y);
+		}
+		if (ratios.y < ratios.x)
+		{
+			collidable.move(0.f, -ratios.y * velocity.y);
+			velocity.y = 0.f;
+		}
+		else if (ratios.x < ratios.y)
+		{
+			collidable.move(-ratios.x * velocity.x, 0.f);
+			velocity.x = 0.f;
+		}
+		else
+		{
+			collidable.move(-ratios.x * velocity.x, -ratios.y * velocity.y);
+			velocity = sf::Vector2f(0.f, 0.f);
+		}
+	}
+
 	class Entity : public sf::Drawable
 	{
 	protected:
@@ -66,6 +138,16 @@ namespace sfext
 		{
 			return m_collidable.getBoundingBox();
 		}
+		const sf::VertexArray & getVertices    () const
+		{
+			// Returns the vertices that draw submits, which is what EntityHandler copies into its batches
+			return m_vertices;
+		}
+		virtual const sf::Texture * getBatchTexture() const
+		{
+			// Returns the texture that the vertices are drawn with, or nullptr if they are untextured
+			return nullptr;
+		}
 		// Mutators
 		void setVelocity  (const sf::Vector2f & vel)
 		{
@@ -122,75 +204,9 @@ namespace sfext
 
 			// Assumes a static Entity for 'other'. This should be used for intersections with terrain, boundaries, etc.
 			// This intersection method is not to be used with two moving entities, as the results are undefined and will often not be what is expected. Use with caution.
-			Collidable otherCollidable = other.getCollidable();
-			sf::Vector2f center = m_collidable.getCenter();
 			if (intersects(other))
 			{
-				if (m_velocity.x == 0.f)
-				{
-					if (m_velocity.y < 0.f) // Object is moving straight up
-					{
-						m_collidable.move(0.f, otherCollidable.getPosition().y + otherCollidable.getDimensions().y - getPosition().y);
-					}
-					else if (m_velocity.y > 0.f) // Object is moving straight down
-					{
-						m_collidable.move(0.f, otherCollidable.getPosition().y - getPosition().y - getDimensions().y);
-					}
-					m_velocity.y = 0.f;
-					return;
-				}
-				else if (m_velocity.y == 0.f)
-				{
-					if (m_velocity.x < 0.f) // Object is moving straight to the left
-					{
-						m_collidable.move(otherCollidable.getPosition().x + otherCollidable.getDimensions().x - getPosition().x, 0.f);
-					}
-					else if (m_velocity.x > 0.f) // Object is moving straight to the right
-					{
-						m_collidable.move(otherCollidable.getPosition().x - getPosition().x - getDimensions().x, 0.f);
-					}
-					m_velocity.x = 0.f;
-					return;
-				}
-				sf::Vector2f offset(0.f, 0.f);
-				sf::Vector2f ratios(0.f, 0.f);
-				if (m_velocity.x < 0.f && m_velocity.y < 0.f)
-				{
-					offset = getPosition() - otherCollidable.getPosition() - otherCollidable.getDimensions();
-					ratios = sf::Vector2f(offset.x / m_velocity.x, offset.y / m_velocity.y);
-				}
-				else if (m_velocity.x < 0.f && m_velocity.y > 0.f)
-				{
-					offset.x = getPosition().x - otherCollidable.getPosition().x - otherCollidable.getDimensions().x;
-					offset.y = getPosition().y + getDimensions().y - otherCollidable.getPosition().y;
-					ratios = sf::Vector2f(offset.x / m_velocity.x, offset.y / m_velocity.y);
-				}
-				else if (m_velocity.x > 0.f && m_velocity.y < 0.f)
-				{
-					offset.x = getPosition().x + getDimensions().x - otherCollidable.getPosition().x;
-					offset.y = getPosition().y - otherCollidable.getPosition().y - otherCollidable.getDimensions().y;
-					ratios = sf::Vector2f(offset.x / m_velocity.x, offset.y / m_velocity.y);
-				}
-				else if (m_velocity.x > 0.f && m_velocity.y > 0.f)
-				{
-					offset = getPosition() + getDimensions() - otherCollidable.getPosition();
-					ratios = sf::Vector2f(offset.x / m_velocity.x, offset.y / m_velocity.y);
-				}
-				if (ratios.y < ratios.x)
-				{
-					m_collidable.move(0.f, -ratios.y * m_velocity.y);
-					m_velocity.y = 0.f;
-				}
-				else if (ratios.x < ratios.y)
-				{
-					m_collidable.move(-ratios.x * m_velocity.x, 0.f);
-					m_velocity.x = 0.f;
-				}
-				else
-				{
-					m_collidable.move(-ratios.x * m_velocity.x, -ratios.y * m_velocity.y);
-					m_velocity = sf::Vector2f(0.f, 0.f);
-				}
+				resolveIntersection(m_collidable, m_velocity, other.getCollidable());
 			}
 			updateVertices();
 		}
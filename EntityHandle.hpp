@@ -0,0 +1,8 @@
+#pragma once
+
+#include "SlotHandle.hpp"
+
+namespace sfext
+{
+	typedef SlotHandle EntityHandle; // Refers to an entity of an EntityHandler or an EntityWorld
+}
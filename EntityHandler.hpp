@@ -4,95 +4,940 @@
 #include <SFML/System/String.hpp>
 #include <SFML/Graphics/Drawable.hpp>
 
+#include "BroadPhase.hpp"
+#include "CollisionMode.hpp"
+#include "Culling.hpp"
+#include "EntityState.hpp"
+#include "FixedTimestep.hpp"
 #include "Entity.hpp"
+#include "EntityHandle.hpp"
+#include "SlotMap.hpp"
+#include "SpatialHash.hpp"
+#include "StringHash.hpp"
+#include "SweepAndPrune.hpp"
+#include "VertexBatch.hpp"
+#include "WorkerPool.hpp"
 
-#include <map>
+#include <unordered_map>
 #include <functional>
 #include <memory>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
 
 // TODO: tests
 // TODO: documentation
 
+// Entities are stored in a SlotMap: a dense array, in the order the entities were added, that update and draw walk
+// from front to back. Removing an entity keeps the others in order. Adding an entity returns an EntityHandle, which
+// finds it again in constant time and becomes stale once the entity is removed. Entities can also be given an alias,
+// which is looked up through a hash table.
+
+// The bounding box of every entity is tracked in a SpatialHash, so intersections are only handled against entities
+// that are nearby. The handler keeps the spatial hash up to date when it adds, removes, or updates an entity. Entities
+// that are moved through other means must be passed to refresh before intersections are handled again.
+
+// In the continuous collision mode, update still calls the update function of each entity, so animation, timers and
+// other logic keep running, but the movement that the update made is taken back and swept instead. The entity is
+// stopped exactly on the face of the first entity in its way, then slides along that entity for the rest of the step.
+// An entity that already overlaps another one can move out of it, but not further into it. Every other entity is
+// treated as stationary while one entity is swept, like handleIntersection does. Fast entities therefore cannot
+// tunnel through thin ones, even at a low update rate.
+
+// Intersections of every moving entity can also be handled with a WorkerPool. The broad and narrow phases, which only
+// read the entities, run on the worker threads and produce a list of contacts for each fixed-size chunk of movers. The
+// contacts are then resolved on the calling thread, chunk by chunk and in storage order. A mover that is pushed to new
+// bounds is then resolved against the entities around them, like a single entity is. Chunk boundaries do not depend on
+// the number of threads, so the results are bit-identical no matter how many threads the pool has, and the same as
+// without a pool.
+
+// The contacts of every moving entity can also be found with a SweepAndPrune instead, which is selected with
+// setBroadPhase. It keeps every entity's bounding box sorted along both axes and finds all overlapping pairs in one
+// sweep, which is cheaper than one spatial hash query per mover once most entities move every frame. The pairs are
+// found on the calling thread, and the contacts are resolved in the same order as with the spatial hash, so both
+// broad phases give the same results. Queries for a single entity or area, like culling and sweeping, always use the
+// spatial hash.
+
+// By default draw calls every entity's own draw function. With batching turned on, runs of consecutive entities that
+// share a texture and primitive type are copied into a persistent VertexBatch instead, and each run is submitted with
+// a single draw call, so entities are still drawn in storage order. Entities with strip or fan primitives cannot be
+// concatenated, so they are drawn on their own and end the run. Batching only draws the vertices of an entity, so it
+// should be left off for entities that override draw to render something else. Batches that a frame did not use are
+// freed at the end of that frame.
+
+// Culling can be turned on to skip the entities that are off screen: the target's view is looked up in the broad
+// phase, so those entities are never visited, let alone written to a batch. An entity is drawn if its bounding box
+// touches the view, like isVisible decides, so entities with no area are drawn too. Culling only knows about the
+// bounding boxes, so it is off by default and should only be turned on when no entity draws outside of its box.
+// drawInterpolated culls every entity by its bounding box at the position it is drawn at.
+
+// Updating every entity at once also remembers where each entity was before the update. Under a FixedTimestep the
+// handler can then be drawn with drawInterpolated, which shows every entity part of the way between its previous and
+// its current position. The previous positions are kept next to the entities in the same order, so an entity that is
+// added between updates is drawn where it is, and adding or removing one does not affect the others.
+
+// Entities that never move, like terrain, can be made static: they are skipped by update and live in a second spatial
+// hash that is only rewritten when they are refreshed. Once a sleep threshold is set, entities that have had no
+// velocity for that many updates also fall asleep and move into the static spatial hash. A sleeping entity is woken
+// up by wake, by refresh, by setVelocity, or when a moving entity runs into it. Code that calls setVelocity on a
+// sleeping entity itself has to wake it (or refresh it) as well, since the handler no longer looks at it.
+
 namespace sfext
 {
 	class EntityHandler : public sf::Drawable
 	{
 	private:
-		std::map<sf::String, std::shared_ptr<Entity>> entities;
+		struct BatchKey
+		{
+			const sf::Texture * texture;
+			sf::PrimitiveType type;
+
+			bool operator == (const BatchKey & rhs) const
+			{
+				return texture == rhs.texture && type == rhs.type;
+			}
+		};
+
+		struct BatchKeyHash
+		{
+			std::size_t operator () (const BatchKey & key) const
+			{
+				return std::hash<const sf::Texture *>()(key.texture) ^ (static_cast<std::size_t>(key.type) * 0x9E3779B9u);
+			}
+		};
+
+		struct BatchList
+		{
+			std::vector<VertexBatch> batches; // One per run with this texture and primitive type
+			std::size_t used; // Batches used by the current frame
+		};
+
+		struct BatchRun
+		{
+			std::size_t first; // Range of m_visible that the run covers
+			std::size_t last;
+			BatchList * list; // nullptr for an entity that is drawn on its own
+			std::size_t vertices;
+		};
+
+		SlotMap<std::shared_ptr<Entity>> m_entities;
+		std::unordered_map<sf::String, EntityHandle, StringHash> m_handles;
+		std::unordered_map<EntityHandle, sf::String, SlotHandleHash> m_aliases;
+		SpatialHash<EntityHandle, SlotHandleHash> m_broadPhase; // Awake entities
+		SpatialHash<EntityHandle, SlotHandleHash> m_staticBroadPhase; // Sleeping and static entities
+		std::vector<EntityState> m_states; // Indexed by the slot of the handle
+		std::vector<unsigned int> m_idleUpdates; // Indexed by the slot of the handle
+		std::vector<EntityHandle> m_awake; // Awake entities in storage order, rebuilt when an entity changes state
+		bool m_awakeChanged;
+		unsigned int m_sleepThreshold;
+		mutable std::vector<EntityHandle> m_candidates;
+		mutable std::vector<EntityHandle> m_resolved; // Candidates that handleIntersections has already handled
+		CollisionMode m_collisionMode;
+		BroadPhase m_broadPhaseType;
+		SweepAndPrune<EntityHandle, SlotHandleHash> m_sweepAndPrune; // Every entity, while the sweep and prune broad phase is selected
+		std::vector<std::size_t> m_moverIndices; // Position of each mover in m_movers, indexed by the slot of the handle
+		std::vector<EntityHandle> m_movers;
+		std::vector<std::vector<std::pair<std::size_t, EntityHandle>>> m_contacts; // Contacts found by each chunk of movers
+		std::vector<std::vector<EntityHandle>> m_chunkCandidates;
+		std::vector<std::vector<std::size_t>> m_chunkScratch;
+		bool m_batching;
+		bool m_culling;
+		mutable std::vector<std::size_t> m_visible; // Storage indices of the entities to draw
+		std::vector<sf::Vector2f> m_previousPositions; // Indexed by the slot of the handle
+		sf::Vector2f m_largestStep; // Farthest that any entity has moved from its previous position, along each axis
+		mutable std::unordered_map<BatchKey, BatchList, BatchKeyHash> m_batches;
+		mutable std::vector<BatchRun> m_runs;
 	public:
+		static const unsigned int MaximumSweeps = 4; // Contacts an entity can slide along during one continuous update
+		static const std::size_t NarrowPhaseChunkSize = 64; // Moving entities whose contacts are found by one task
+
 		// Constructors
-		EntityHandler()
+		EntityHandler() : m_awakeChanged(false), m_sleepThreshold(0), m_collisionMode(CollisionMode::Discrete), m_broadPhaseType(BroadPhase::SpatialHash), m_batching(false), m_culling(false)
+		{
+		}
+		explicit EntityHandler(float cellSize, CollisionMode collisionMode = CollisionMode::Discrete) : m_broadPhase(cellSize), m_staticBroadPhase(cellSize), m_awakeChanged(false), m_sleepThreshold(0), m_collisionMode(collisionMode), m_broadPhaseType(BroadPhase::SpatialHash), m_batching(false), m_culling(false)
 		{
+			// The cell size of the broad phase should be about the size of a typical entity
 		}
 		// Destructor
 		~EntityHandler()
 		{
 		}
 		// Accessors
+		float         getCellSize     () const
+		{
+			return m_broadPhase.getCellSize();
+		}
+		CollisionMode getCollisionMode() const
+		{
+			return m_collisionMode;
+		}
+		unsigned int  getSleepThreshold() const
+		{
+			return m_sleepThreshold;
+		}
+		BroadPhase    getBroadPhase   () const
+		{
+			return m_broadPhaseType;
+		}
+		EntityHandle getHandle  (const sf::String & alias) const
+		{
+			// Returns the handle of the entity with the given alias, or a handle that is never valid if there is none
+			auto found = m_handles.find(alias);
+			return found != m_handles.end() ? found->second : EntityHandle();
+		}
+		Entity *     getEntity  (EntityHandle handle) const
+		{
+			// Returns the entity that the handle refers to, or nullptr if it has been removed
+			const std::shared_ptr<Entity> * entity = m_entities.get(handle);
+			return entity != nullptr ? entity->get() : nullptr;
+		}
+		Entity *     getEntity  (const sf::String & alias) const
+		{
+			// Returns the entity with the given alias, or nullptr if there is none
+			return getEntity(getHandle(alias));
+		}
+		EntityState  getState   (EntityHandle handle) const
+		{
+			// Returns whether the entity is awake, sleeping or static
+			// Entities that have been removed are reported as static
+			return m_entities.contains(handle) ? m_states[handle.index] : EntityState::Static;
+		}
+		EntityState  getState   (const sf::String & alias) const
+		{
+			return getState(getHandle(alias));
+		}
 		// Mutators
+		void setCellSize     (float cellSize)
+		{
+			m_broadPhase.setCellSize(cellSize);
+			m_staticBroadPhase.setCellSize(cellSize);
+		}
+		void setSleepThreshold(unsigned int updates)
+		{
+			// Put entities to sleep after they have had no velocity for this many updates in a row
+			// 0 turns sleeping off, which is the default; entities that are already asleep stay asleep until woken
+			m_sleepThreshold = updates;
+		}
+		void setStatic       (EntityHandle handle, bool isStatic)
+		{
+			// Make an entity static, or make a static entity dynamic (and awake) again
+			if (!m_entities.contains(handle) || (m_states[handle.index] == EntityState::Static) == isStatic)
+				return;
+			setState(handle, isStatic ? EntityState::Static : EntityState::Awake);
+		}
+		void setStatic       (const sf::String & alias, bool isStatic)
+		{
+			setStatic(getHandle(alias), isStatic);
+		}
+		void wake            (EntityHandle handle)
+		{
+			// Wake a sleeping entity up, static entities are not affected
+			if (m_entities.contains(handle) && m_states[handle.index] == EntityState::Sleeping)
+				setState(handle, EntityState::Awake);
+		}
+		void wake            (const sf::String & alias)
+		{
+			wake(getHandle(alias));
+		}
+		void setVelocity     (EntityHandle handle, const sf::Vector2f & velocity)
+		{
+			// Change the velocity of an entity, waking it up if it is sleeping and the velocity is not zero
+			Entity * entity = getEntity(handle);
+			if (entity == nullptr)
+				return;
+			entity->setVelocity(velocity);
+			if (velocity.x != 0.f || velocity.y != 0.f)
+				wake(handle);
+		}
+		void setVelocity     (const sf::String & alias, const sf::Vector2f & velocity)
+		{
+			setVelocity(getHandle(alias), velocity);
+		}
+		void setCollisionMode(CollisionMode collisionMode)
+		{
+			m_collisionMode = collisionMode;
+		}
+		void setBroadPhase   (BroadPhase broadPhase)
+		{
+			// Choose how the contacts of every moving entity are found by handleIntersections
+			if (broadPhase == m_broadPhaseType)
+				return;
+			m_broadPhaseType = broadPhase;
+			m_sweepAndPrune.clear();
+			if (broadPhase == BroadPhase::SweepAndPrune)
+			{
+				for (std::size_t i = 0; i < m_entities.size(); ++i)
+					track(m_entities.handleAt(i));
+			}
+		}
+		EntityHandle addEntity(const std::shared_ptr<Entity> & entity)
+		{
+			// Add an entity without an alias
+			EntityHandle handle = m_entities.insert(entity);
+			if (m_states.size() <= handle.index)
+			{
+				m_states.resize(handle.index + 1, EntityState::Awake);
+				m_idleUpdates.resize(handle.index + 1, 0);
+				m_previousPositions.resize(handle.index + 1);
+			}
+			m_previousPositions[handle.index] = entity ? entity->getPosition() : sf::Vector2f();
+			m_states[handle.index] = EntityState::Awake;
+			m_idleUpdates[handle.index] = 0;
+			m_awakeChanged = true;
+			track(handle);
+			return handle;
+		}
+		EntityHandle addEntity(const sf::String & alias, const std::shared_ptr<Entity> & entity)
+		{
+			// Add an entity under an alias
+			// If the alias is already taken, its entity is replaced and keeps its handle
+			auto found = m_handles.find(alias);
+			if (found != m_handles.end())
+			{
+				*m_entities.get(found->second) = entity;
+				m_previousPositions[found->second.index] = entity ? entity->getPosition() : sf::Vector2f();
+				if (m_states[found->second.index] == EntityState::Static)
+					track(found->second);
+				else
+					setState(found->second, EntityState::Awake);
+				return found->second;
+			}
+			EntityHandle handle = addEntity(entity);
+			m_handles[alias] = handle;
+			m_aliases[handle] = alias;
+			return handle;
+		}
 		template <class EntityType>
-		void addEntity(const sf::String & alias, const std::function<std::shared_ptr<EntityType>> & allocator)
+		EntityHandle addEntity(const sf::String & alias, const std::function<std::shared_ptr<EntityType> ()> & allocator)
 		{
-			entities[alias] = allocator();
+			return addEntity(alias, std::shared_ptr<Entity>(allocator()));
 		}
 		template <class EntityType, class T>
-		void addEntity(const sf::String & alias, const std::function<std::shared_ptr<EntityType> (const T &)> & allocator, const T & parameterOne)
+		EntityHandle addEntity(const sf::String & alias, const std::function<std::shared_ptr<EntityType> (const T &)> & allocator, const T & parameterOne)
 		{
-			entities[alias] = allocator(parameterOne);
+			return addEntity(alias, std::shared_ptr<Entity>(allocator(parameterOne)));
 		}
 		template <class EntityType, class T, class U>
-		void addEntity(const sf::String & alias, const std::function<std::shared_ptr<EntityType> (const T &, const U &)> & allocator, const T & parameterOne, const U & parameterTwo)
+		EntityHandle addEntity(const sf::String & alias, const std::function<std::shared_ptr<EntityType> (const T &, const U &)> & allocator, const T & parameterOne, const U & parameterTwo)
 		{
-			entities[alias] = allocator(parameterOne, parameterTwo);
+			return addEntity(alias, std::shared_ptr<Entity>(allocator(parameterOne, parameterTwo)));
 		}
 		template <class EntityType, class T, class U, class V>
-		void addEntity(const sf::String & alias, const std::function<std::shared_ptr<EntityType> (const T &, const U &, const V &)> & allocator, const T & parameterOne, const U & parameterTwo, const V & parameterThree)
+		EntityHandle addEntity(const sf::String & alias, const std::function<std::shared_ptr<EntityType> (const T &, const U &, const V &)> & allocator, const T & parameterOne, const U & parameterTwo, const V & parameterThree)
 		{
-			entities[alias] = allocator(parameterOne, parameterTwo, parameterThree);
+			return addEntity(alias, std::shared_ptr<Entity>(allocator(parameterOne, parameterTwo, parameterThree)));
+		}
+		void removeEntity(EntityHandle handle)
+		{
+			if (!m_entities.erase(handle))
+				return;
+			m_broadPhase.remove(handle);
+			m_staticBroadPhase.remove(handle);
+			m_sweepAndPrune.remove(handle);
+			m_awakeChanged = true;
+			auto alias = m_aliases.find(handle);
+			if (alias != m_aliases.end())
+			{
+				m_handles.erase(alias->second);
+				m_aliases.erase(alias);
+			}
 		}
 		void removeEntity(const sf::String & alias)
 		{
-			if (hasEntity(alias))
+			auto found = m_handles.find(alias);
+			if (found != m_handles.end())
 			{
-				entities.erase(alias);
+				removeEntity(found->second);
 			}
 		}
+		void refresh     ()
+		{
+			// Resynchronize the broad phase with the bounds of every entity, waking up the sleeping ones
+			for (std::size_t i = 0; i < m_entities.size(); ++i)
+				refresh(m_entities.handleAt(i));
+		}
+		void refresh     (EntityHandle handle)
+		{
+			// Resynchronize the broad phase with the bounds of a single entity, waking it up if it is sleeping
+			if (!m_entities.contains(handle))
+				return;
+			if (m_states[handle.index] == EntityState::Sleeping)
+				setState(handle, EntityState::Awake);
+			else
+				track(handle);
+		}
+		void refresh     (const sf::String & alias)
+		{
+			refresh(getHandle(alias));
+		}
 		// Utilities
 		void         handleIntersections(Entity & entity) const
 		{
-			for (const auto & pair : entities)
+			// Only entities whose bounds intersect the entity's bounds can affect it, so the others are skipped
+			// The candidates are handled in storage order, the same order as a walk over every entity
+			// Whenever a response moves the entity, the candidates are gathered again around its new bounds, so that
+			// entities it was pushed into are handled too; every entity is still handled at most once
+			m_resolved.clear();
+			gatherCandidates(entity.getBoundingBox());
+			std::size_t next = 0;
+			while (next < m_candidates.size())
 			{
-				entity.handleIntersection(*(pair.second));
+				EntityHandle candidate = m_candidates[next++];
+				if (std::find(m_resolved.begin(), m_resolved.end(), candidate) != m_resolved.end())
+					continue;
+				m_resolved.push_back(candidate);
+				sf::FloatRect bounds = entity.getBoundingBox();
+				entity.handleIntersection(**m_entities.get(candidate));
+				if (entity.getBoundingBox() != bounds)
+				{
+					gatherCandidates(entity.getBoundingBox());
+					next = 0;
+				}
 			}
 		}
+		void         handleIntersections(EntityHandle handle)
+		{
+			// Handle the intersections of an entity owned by this handler with every other entity
+			Entity * entity = getEntity(handle);
+			if (entity == nullptr)
+				return;
+			m_resolved.clear();
+			resolveAround(handle, *entity);
+			track(handle);
+		}
+		void         handleIntersections(const sf::String & alias)
+		{
+			handleIntersections(getHandle(alias));
+		}
+		void         handleIntersections()
+		{
+			// Handle the intersections of every moving entity with the entities around it, on the calling thread
+			resolveMovers(nullptr);
+		}
+		void         handleIntersections(WorkerPool & workers)
+		{
+			// Handle the intersections of every moving entity with the entities around it
+			// Contacts are found in parallel against a snapshot of the bounds, then resolved in a fixed order
+			resolveMovers(&workers);
+		}
 		void         update             (sf::Time elapsed)
 		{
-			for (auto & pair : entities)
+			// Update every awake entity, remembering where each entity was for drawInterpolated
+			// Entities that have had no velocity for the sleep threshold are put to sleep afterwards
+			for (std::size_t i = 0; i < m_entities.size(); ++i)
+				m_previousPositions[m_entities.handleAt(i).index] = m_entities[i]->getPosition();
+			m_largestStep = sf::Vector2f();
+			for (EntityHandle handle : awakeEntities())
 			{
-				pair.second->update(elapsed);
+				Entity & entity = **m_entities.get(handle);
+				advance(handle, entity, elapsed);
+				sf::Vector2f velocity = entity.getVelocity();
+				if (velocity.x != 0.f || velocity.y != 0.f)
+					m_idleUpdates[handle.index] = 0;
+				else
+					++m_idleUpdates[handle.index];
 			}
+			if (m_sleepThreshold == 0)
+				return;
+			for (EntityHandle handle : m_awake)
+				if (m_idleUpdates[handle.index] >= m_sleepThreshold && m_states[handle.index] == EntityState::Awake)
+					setState(handle, EntityState::Sleeping);
 		}
-		void         update             (const sf::String & alias, sf::Time elapsed)
+		void         update             (EntityHandle handle, sf::Time elapsed)
 		{
-			if (hasEntity(alias))
+			Entity * entity = getEntity(handle);
+			if (entity != nullptr)
 			{
-				entities.at(alias)->update(elapsed);
+				advance(handle, *entity, elapsed);
 			}
 		}
+		void         update             (const sf::String & alias, sf::Time elapsed)
+		{
+			update(getHandle(alias), elapsed);
+		}
 		virtual void draw               (sf::RenderTarget & target, sf::RenderStates states = sf::RenderStates::Default) const
 		{
-			for (const auto & pair : entities)
-			{
-				target.draw(*(pair.second), states);
-			}
+			// Draw every entity where it currently is
+			render(target, states, 1.f);
+		}
+		void         drawInterpolated   (sf::RenderTarget & target, float alpha, sf::RenderStates states = sf::RenderStates::Default) const
+		{
+			// Draw every entity alpha of the way from where it was before the last update to where it is now
+			// alpha is usually FixedTimestep::getAlpha
+			render(target, states, alpha);
+		}
+		bool         hasEntity          (EntityHandle handle) const
+		{
+			return m_entities.contains(handle);
 		}
 		bool         hasEntity          (const sf::String & alias) const
 		{
-			return entities.find(alias) != entities.cend();
+			return m_handles.find(alias) != m_handles.cend();
 		}
 		std::size_t  size               () const
 		{
-			return entities.size();
+			return m_entities.size();
+		}
+		bool         isBatching         () const
+		{
+			return m_batching;
+		}
+		void         setBatching        (bool batching)
+		{
+			// Turn batched drawing on or off, it is off by default
+			// With batching off every entity is drawn with its own draw call, through its own draw function
+			m_batching = batching;
+			if (!batching)
+				m_batches.clear();
+		}
+		bool         isCulling          () const
+		{
+			return m_culling;
+		}
+		void         setCulling         (bool culling)
+		{
+			// Turn view culling on or off
+			// With culling off every entity is drawn, whether it is on screen or not
+			m_culling = culling;
+		}
+	private:
+		void resolveMovers   (WorkerPool * workers)
+		{
+			// Find the contacts of every moving entity against a snapshot of the bounds, on the workers if there are any,
+			// then resolve them in a fixed order
+			// A mover that a response moved is resolved further against the entities around its new bounds, the same way
+			// handleIntersections(EntityHandle) does
+			// Sleeping and static entities never move, so only awake entities are considered
+			m_movers.clear();
+			for (EntityHandle handle : awakeEntities())
+			{
+				sf::Vector2f velocity = (*m_entities.get(handle))->getVelocity();
+				if (velocity.x != 0.f || velocity.y != 0.f)
+					m_movers.push_back(handle);
+			}
+			const std::size_t chunks = m_broadPhaseType == BroadPhase::SweepAndPrune ? std::min<std::size_t>(m_movers.size(), 1) : (m_movers.size() + NarrowPhaseChunkSize - 1) / NarrowPhaseChunkSize;
+			if (m_contacts.size() < chunks)
+			{
+				m_contacts.resize(chunks);
+				m_chunkCandidates.resize(chunks);
+				m_chunkScratch.resize(chunks);
+			}
+			if (m_broadPhaseType == BroadPhase::SweepAndPrune)
+			{
+				if (chunks != 0)
+					findPairContacts();
+			}
+			else
+			{
+				m_entities.compact(); // The workers read the storage by position
+				auto task = [this](std::size_t first, std::size_t last)
+				{
+					findContacts(first, last);
+				};
+				if (workers != nullptr)
+					workers->parallelFor(m_movers.size(), NarrowPhaseChunkSize, task);
+				else
+					for (std::size_t first = 0; first < m_movers.size(); first += NarrowPhaseChunkSize)
+						task(first, std::min(first + NarrowPhaseChunkSize, m_movers.size()));
+			}
+			for (std::size_t chunk = 0; chunk < chunks; ++chunk)
+			{
+				const std::vector<std::pair<std::size_t, EntityHandle>> & contacts = m_contacts[chunk];
+				std::size_t next = 0;
+				while (next < contacts.size())
+				{
+					const std::size_t mover = contacts[next].first;
+					Entity & entity = **m_entities.get(m_movers[mover]);
+					sf::FloatRect bounds = entity.getBoundingBox();
+					m_resolved.clear();
+					for (; next < contacts.size() && contacts[next].first == mover; ++next)
+					{
+						wake(contacts[next].second);
+						entity.handleIntersection(**m_entities.get(contacts[next].second));
+						m_resolved.push_back(contacts[next].second);
+					}
+					if (entity.getBoundingBox() != bounds)
+						resolveAround(m_movers[mover], entity);
+				}
+			}
+			for (EntityHandle mover : m_movers)
+				track(mover);
+		}
+		void resolveAround   (EntityHandle handle, Entity & entity)
+		{
+			// Resolve an entity against the entities around its bounds that are not in m_resolved yet, in storage order
+			// Whenever a response moves the entity, the candidates are gathered again around its new bounds, so that
+			// entities it was pushed into are handled too; every entity is still handled at most once
+			gatherCandidates(entity.getBoundingBox());
+			std::size_t next = 0;
+			while (next < m_candidates.size())
+			{
+				EntityHandle candidate = m_candidates[next++];
+				if (candidate == handle || std::find(m_resolved.begin(), m_resolved.end(), candidate) != m_resolved.end())
+					continue;
+				m_resolved.push_back(candidate);
+				const Entity & other = **m_entities.get(candidate);
+				if (m_states[candidate.index] == EntityState::Sleeping && entity.intersects(other))
+					wake(candidate);
+				sf::FloatRect bounds = entity.getBoundingBox();
+				entity.handleIntersection(other);
+				if (entity.getBoundingBox() != bounds)
+				{
+					gatherCandidates(entity.getBoundingBox());
+					next = 0;
+				}
+			}
+		}
+		void advance         (EntityHandle handle, Entity & entity, sf::Time elapsed)
+		{
+			// Update an entity
+			// In the continuous collision mode, the movement of the update is undone and swept instead
+			sf::Vector2f start = entity.getPosition();
+			entity.update(elapsed);
+			if (m_collisionMode == CollisionMode::Continuous)
+			{
+				sf::Vector2f displacement = entity.getPosition() - start;
+				if (displacement.x != 0.f || displacement.y != 0.f)
+				{
+					entity.setPosition(start);
+					sweep(handle, entity, displacement);
+				}
+			}
+			track(handle);
+		}
+		void sweep           (EntityHandle handle, Entity & entity, sf::Vector2f displacement)
+		{
+			// Move an entity by displacement, stopping it on the face of the earliest contact and sliding it along the contact
+			// Entities that it already intersects only block the part of the movement that goes further into them
+			for (unsigned int i = 0; i < MaximumSweeps && (displacement.x != 0.f || displacement.y != 0.f); ++i)
+			{
+				Collidable collidable = entity.getCollidable();
+				sf::FloatRect bounds = collidable.getBoundingBox();
+				sf::FloatRect swept(std::min(bounds.left, bounds.left + displacement.x), std::min(bounds.top, bounds.top + displacement.y), bounds.width + std::abs(displacement.x), bounds.height + std::abs(displacement.y));
+				gatherCandidates(swept);
+				float earliest = 1.f;
+				sf::Vector2f normal;
+				bool hit = false;
+				bool overlapping = false;
+				EntityHandle contact;
+				sf::FloatRect contactBounds;
+				for (EntityHandle candidate : m_candidates)
+				{
+					float time;
+					sf::Vector2f candidateNormal;
+					const Collidable & other = (*m_entities.get(candidate))->getCollidable();
+					if (candidate == handle || !collidable.sweep(displacement, other, time, candidateNormal))
+						continue;
+					bool overlap = candidateNormal.x == 0.f && candidateNormal.y == 0.f;
+					if (overlap)
+						candidateNormal = penetrationNormal(bounds, other.getBoundingBox(), displacement);
+					if ((candidateNormal.x != 0.f || candidateNormal.y != 0.f) && (!hit || time < earliest))
+					{
+						earliest = time;
+						normal = candidateNormal;
+						contact = candidate;
+						contactBounds = other.getBoundingBox();
+						overlapping = overlap;
+						hit = true;
+					}
+				}
+				sf::Vector2f position(bounds.left + displacement.x * earliest, bounds.top + displacement.y * earliest);
+				if (hit && !overlapping)
+				{
+					// Put the entity on the face that it hit, since the position above can round to a few ulps inside it
+					if (normal.x != 0.f)
+						position.x = normal.x < 0.f ? placeBefore(contactBounds.left, bounds.width) : contactBounds.left + contactBounds.width;
+					else
+						position.y = normal.y < 0.f ? placeBefore(contactBounds.top, bounds.height) : contactBounds.top + contactBounds.height;
+				}
+				entity.setPosition(position);
+				if (!hit)
+					return;
+				wake(contact);
+				// Remove the part of the movement and velocity that goes into the contact
+				sf::Vector2f velocity = entity.getVelocity();
+				displacement *= 1.f - earliest;
+				if (normal.x != 0.f)
+				{
+					displacement.x = 0.f;
+					velocity.x = 0.f;
+				}
+				else
+				{
+					displacement.y = 0.f;
+					velocity.y = 0.f;
+				}
+				entity.setVelocity(velocity);
+			}
+		}
+		static sf::Vector2f penetrationNormal(const sf::FloatRect & bounds, const sf::FloatRect & other, const sf::Vector2f & displacement)
+		{
+			// Returns the normal of the side of other that an overlapping box is pushed out through, if displacement moves
+			// it further in on that axis, and (0, 0) if it does not
+			float overlapX = std::min(bounds.left + bounds.width, other.left + other.width) - std::max(bounds.left, other.left);
+			float overlapY = std::min(bounds.top + bounds.height, other.top + other.height) - std::max(bounds.top, other.top);
+			float towardsX = (other.left + other.width * .5f) - (bounds.left + bounds.width * .5f);
+			float towardsY = (other.top + other.height * .5f) - (bounds.top + bounds.height * .5f);
+			if (overlapX <= overlapY)
+			{
+				if (displacement.x != 0.f && (displacement.x > 0.f) == (towardsX > 0.f))
+					return sf::Vector2f(displacement.x > 0.f ? -1.f : 1.f, 0.f);
+			}
+			else if (displacement.y != 0.f && (displacement.y > 0.f) == (towardsY > 0.f))
+			{
+				return sf::Vector2f(0.f, displacement.y > 0.f ? -1.f : 1.f);
+			}
+			return sf::Vector2f(0.f, 0.f);
+		}
+		static float        placeBefore      (float edge, float length)
+		{
+			// Returns the position at which an interval of the given length ends exactly at edge without crossing it
+			float position = edge - length;
+			while (position + length > edge)
+				position = std::nextafter(position, -std::numeric_limits<float>::infinity());
+			return position;
+		}
+		void findContacts    (std::size_t first, std::size_t last)
+		{
+			// Find the entities that each mover in [first, last) intersects, and record them in the chunk's contact list
+			// Only reads the entities and the broad phase, so chunks can run concurrently
+			const std::size_t chunk = first / NarrowPhaseChunkSize;
+			std::vector<std::pair<std::size_t, EntityHandle>> & contacts = m_contacts[chunk];
+			std::vector<EntityHandle> & candidates = m_chunkCandidates[chunk];
+			contacts.clear();
+			for (std::size_t mover = first; mover < last; ++mover)
+			{
+				const Entity & entity = **m_entities.get(m_movers[mover]);
+				candidates.clear();
+				m_broadPhase.query(entity.getBoundingBox(), candidates, m_chunkScratch[chunk]);
+				m_staticBroadPhase.query(entity.getBoundingBox(), candidates, m_chunkScratch[chunk]);
+				std::sort(candidates.begin(), candidates.end(), [this](EntityHandle left, EntityHandle right) { return m_entities.indexOf(left) < m_entities.indexOf(right); });
+				for (EntityHandle candidate : candidates)
+				{
+					if (candidate != m_movers[mover] && entity.intersects(**m_entities.get(candidate)))
+						contacts.emplace_back(mover, candidate);
+				}
+			}
+		}
+		void findPairContacts()
+		{
+			// Find the entities that each mover intersects from the overlapping pairs of the sweep and prune, and record
+			// them in the first chunk's contact list, ordered by mover and then by storage order like findContacts does
+			std::vector<std::pair<std::size_t, EntityHandle>> & contacts = m_contacts[0];
+			contacts.clear();
+			m_moverIndices.assign(m_states.size(), m_movers.size());
+			for (std::size_t mover = 0; mover < m_movers.size(); ++mover)
+				m_moverIndices[m_movers[mover].index] = mover;
+			for (const std::pair<EntityHandle, EntityHandle> & pair : m_sweepAndPrune.findPairs())
+			{
+				addPairContact(pair.first, pair.second);
+				addPairContact(pair.second, pair.first);
+			}
+			std::sort(contacts.begin(), contacts.end(), [this](const std::pair<std::size_t, EntityHandle> & left, const std::pair<std::size_t, EntityHandle> & right)
+			{
+				return left.first != right.first ? left.first < right.first : m_entities.indexOf(left.second) < m_entities.indexOf(right.second);
+			});
+		}
+		void addPairContact  (EntityHandle handle, EntityHandle other)
+		{
+			// Record a contact if handle is a mover that intersects other
+			std::size_t mover = m_moverIndices[handle.index];
+			if (mover < m_movers.size() && m_movers[mover] == handle && (*m_entities.get(handle))->intersects(**m_entities.get(other)))
+				m_contacts[0].emplace_back(mover, other);
+		}
+		void render          (sf::RenderTarget & target, const sf::RenderStates & states, float alpha) const
+		{
+			// Draw the visible entities, offset towards their previous positions unless alpha is 1
+			// With batching on there is one draw call per run of entities with the same texture and primitive type
+			bool interpolating = alpha != 1.f;
+			gatherVisible(target, states, interpolating ? alpha : 1.f);
+			if (!m_batching)
+			{
+				for (std::size_t index : m_visible)
+				{
+					sf::RenderStates entityStates = states;
+					if (interpolating)
+						entityStates.transform.translate(offset(index, alpha));
+					target.draw(*m_entities[index], entityStates);
+				}
+				return;
+			}
+			gatherRuns();
+			for (const BatchRun & run : m_runs)
+			{
+				if (run.list == nullptr)
+				{
+					sf::RenderStates entityStates = states;
+					if (interpolating)
+						entityStates.transform.translate(offset(m_visible[run.first], alpha));
+					target.draw(*m_entities[m_visible[run.first]], entityStates);
+					continue;
+				}
+				const Entity & front = *m_entities[m_visible[run.first]];
+				if (run.list->used == run.list->batches.size())
+					run.list->batches.emplace_back(front.getVertices().getPrimitiveType());
+				VertexBatch & batch = run.list->batches[run.list->used++];
+				sf::Vertex * cursor = batch.resize(run.vertices);
+				for (std::size_t i = run.first; i < run.last; ++i)
+				{
+					const sf::VertexArray & vertices = m_entities[m_visible[i]]->getVertices();
+					sf::Vector2f shift = interpolating ? offset(m_visible[i], alpha) : sf::Vector2f();
+					for (std::size_t vertex = 0; vertex < vertices.getVertexCount(); ++vertex)
+					{
+						*cursor = vertices[vertex];
+						cursor->position += shift;
+						++cursor;
+					}
+				}
+				sf::RenderStates batchStates = states;
+				batchStates.texture = front.getBatchTexture();
+				target.draw(batch, batchStates);
+			}
+			pruneBatches();
+		}
+		sf::Vector2f offset  (std::size_t index, float alpha) const
+		{
+			// Returns how far the entity at a storage index has to be moved back to be drawn at its interpolated position
+			sf::Vector2f position = m_entities[index]->getPosition();
+			return interpolate(m_previousPositions[m_entities.handleAt(index).index], position, alpha) - position;
+		}
+		void gatherVisible   (const sf::RenderTarget & target, const sf::RenderStates & states, float alpha) const
+		{
+			// Fill m_visible with the storage indices of the entities to draw, in order
+			// When interpolating, the view is widened by the largest step so that the broad phase finds every entity that
+			// could be drawn on screen, and each of them is then tested where it is drawn
+			m_visible.clear();
+			if (!m_culling)
+			{
+				for (std::size_t i = 0; i < m_entities.size(); ++i)
+					m_visible.push_back(i);
+				return;
+			}
+			sf::FloatRect visible = getVisibleBounds(target, states);
+			sf::FloatRect area = visible;
+			if (alpha != 1.f)
+				area = sf::FloatRect(visible.left - m_largestStep.x, visible.top - m_largestStep.y, visible.width + 2.f * m_largestStep.x, visible.height + 2.f * m_largestStep.y);
+			auto touches = [](const sf::FloatRect & bounds, const sf::FloatRect & view) { return isVisible(view, bounds); };
+			m_candidates.clear();
+			m_broadPhase.queryIf(area, m_candidates, touches);
+			m_staticBroadPhase.queryIf(area, m_candidates, touches);
+			std::sort(m_candidates.begin(), m_candidates.end(), [this](EntityHandle left, EntityHandle right) { return m_entities.indexOf(left) < m_entities.indexOf(right); });
+			for (EntityHandle candidate : m_candidates)
+			{
+				std::size_t index = m_entities.indexOf(candidate);
+				if (alpha != 1.f)
+				{
+					sf::FloatRect bounds = m_entities[index]->getBoundingBox();
+					sf::Vector2f shift = offset(index, alpha);
+					if (!isVisible(visible, sf::FloatRect(bounds.left + shift.x, bounds.top + shift.y, bounds.width, bounds.height)))
+						continue;
+				}
+				m_visible.push_back(index);
+			}
+		}
+		void gatherRuns      () const
+		{
+			// Split the visible entities into runs of consecutive entities with the same texture and primitive type
+			// Entities that cannot be batched get a run of their own
+			for (auto & list : m_batches)
+				list.second.used = 0;
+			m_runs.clear();
+			BatchList * previous = nullptr;
+			for (std::size_t i = 0; i < m_visible.size(); ++i)
+			{
+				const Entity & entity = *m_entities[m_visible[i]];
+				sf::PrimitiveType type = entity.getVertices().getPrimitiveType();
+				BatchList * list = isBatchable(type) ? &m_batches[BatchKey{ entity.getBatchTexture(), type }] : nullptr;
+				if (list != nullptr && list == previous)
+				{
+					m_runs.back().last = i + 1;
+					m_runs.back().vertices += entity.getVertices().getVertexCount();
+					continue;
+				}
+				m_runs.push_back(BatchRun{ i, i + 1, list, list != nullptr ? entity.getVertices().getVertexCount() : 0 });
+				previous = list;
+			}
+		}
+		void pruneBatches    () const
+		{
+			// Free the batches that the frame did not use
+			for (auto list = m_batches.begin(); list != m_batches.end(); )
+			{
+				if (list->second.used == 0)
+				{
+					list = m_batches.erase(list);
+					continue;
+				}
+				list->second.batches.erase(list->second.batches.begin() + list->second.used, list->second.batches.end());
+				++list;
+			}
+		}
+		static bool isBatchable     (sf::PrimitiveType type)
+		{
+			// Returns true if separate primitives of this type can be concatenated into one vertex array
+			return type == sf::PrimitiveType::Points || type == sf::PrimitiveType::Lines || type == sf::PrimitiveType::Triangles || type == sf::PrimitiveType::Quads;
+		}
+		void track           (EntityHandle handle)
+		{
+			// Insert an entity into the broad phase for its state, or move it to its current bounds
+			const std::shared_ptr<Entity> & entity = *m_entities.get(handle);
+			SpatialHash<EntityHandle, SlotHandleHash> & broadPhase = m_states[handle.index] == EntityState::Awake ? m_broadPhase : m_staticBroadPhase;
+			if (entity)
+			{
+				broadPhase.insert(handle, entity->getBoundingBox());
+				sf::Vector2f step = entity->getPosition() - m_previousPositions[handle.index];
+				m_largestStep.x = std::max(m_largestStep.x, std::abs(step.x));
+				m_largestStep.y = std::max(m_largestStep.y, std::abs(step.y));
+			}
+			else
+			{
+				broadPhase.remove(handle);
+			}
+			if (m_broadPhaseType == BroadPhase::SweepAndPrune)
+			{
+				if (entity)
+					m_sweepAndPrune.insert(handle, entity->getBoundingBox());
+				else
+					m_sweepAndPrune.remove(handle);
+			}
+		}
+		void setState        (EntityHandle handle, EntityState state)
+		{
+			// Change the state of an entity and move it into the broad phase for that state
+			(m_states[handle.index] == EntityState::Awake ? m_broadPhase : m_staticBroadPhase).remove(handle);
+			if ((m_states[handle.index] == EntityState::Awake) != (state == EntityState::Awake))
+				m_awakeChanged = true;
+			m_states[handle.index] = state;
+			m_idleUpdates[handle.index] = 0;
+			track(handle);
+		}
+		const std::vector<EntityHandle> & awakeEntities()
+		{
+			// Returns the awake entities in storage order, rebuilding the list if an entity has changed state
+			// Entities that change state while the list is walked are picked up the next time it is asked for
+			if (m_awakeChanged)
+			{
+				m_awake.clear();
+				for (std::size_t i = 0; i < m_entities.size(); ++i)
+				{
+					EntityHandle handle = m_entities.handleAt(i);
+					if (m_states[handle.index] == EntityState::Awake)
+						m_awake.push_back(handle);
+				}
+				m_awakeChanged = false;
+			}
+			return m_awake;
+		}
+		void gatherCandidates(const sf::FloatRect & bounds) const
+		{
+			// Collect the entities whose bounds intersect bounds, in storage order
+			m_candidates.clear();
+			m_broadPhase.query(bounds, m_candidates);
+			m_staticBroadPhase.query(bounds, m_candidates);
+			std::sort(m_candidates.begin(), m_candidates.end(), [this](EntityHandle left, EntityHandle right) { return m_entities.indexOf(left) < m_entities.indexOf(right); });
 		}
 	};
 }
\ No newline at end of file
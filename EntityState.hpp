@@ -0,0 +1,11 @@
+#pragma once
+
+namespace sfext
+{
+	enum class EntityState
+	{
+		Awake, // Updated every frame and tested for intersections when it moves
+		Sleeping, // Has not moved for a while, skipped until something wakes it up
+		Static // Never updated or woken up, until it is made dynamic again
+	};
+}
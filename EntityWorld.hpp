@@ -0,0 +1,338 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <SFML/Graphics/Color.hpp>
+#include <SFML/Graphics/Drawable.hpp>
+#include <SFML/Graphics/Rect.hpp>
+#include <SFML/Graphics/RenderTarget.hpp>
+#include <SFML/Graphics/Texture.hpp>
+#include <SFML/System/Time.hpp>
+#include <SFML/System/Vector2.hpp>
+
+#include "Collidable.hpp"
+#include "ComponentStore.hpp"
+#include "Entity.hpp"
+#include "EntityHandle.hpp"
+#include "SpatialHash.hpp"
+#include "VertexBatch.hpp"
+
+// The EntityWorld class is the entity-component-system counterpart to the EntityHandler.
+
+// An entity in an EntityWorld is just a handle. What an Entity object bundles together is split into components, each
+// type of which is stored contiguously in its own ComponentStore:
+//   - a Collidable, which gives the entity its position and size
+//   - a velocity, which makes the entity move
+//   - a RenderComponent, which makes the entity visible as a colored or textured quad
+// The systems only iterate the components they need: move walks the velocities, handleIntersections walks the
+// velocities and looks up their collidables, and draw walks the render components. None of them go through a virtual
+// call or a per-entity heap allocation.
+
+// Entities with a Collidable but no velocity are obstacles. Moving entities are resolved against them the same way
+// Entity::handleIntersection resolves an entity against a static one. The obstacles are kept in a SpatialHash, which is
+// rebuilt whenever an entity becomes or stops being an obstacle. An obstacle that is moved through getCollidable does
+// not rebuild it, so call invalidateObstacles after moving obstacles that way.
+
+// TODO: tests
+
+namespace sfext
+{
+	struct RenderComponent
+	{
+		sf::Color color;
+		const sf::Texture * texture; // nullptr for an untextured quad
+		sf::FloatRect textureRect; // An empty rectangle maps the texture like a TexturedEntity, one texel per unit
+
+		explicit RenderComponent(const sf::Color & quadColor = sf::Color::White, const sf::Texture * quadTexture = nullptr, const sf::FloatRect & quadTextureRect = sf::FloatRect()) : color(quadColor), texture(quadTexture), textureRect(quadTextureRect)
+		{
+		}
+	};
+
+	class EntityWorld final : public sf::Drawable
+	{
+	private:
+		std::vector<std::uint32_t> m_generations;
+		std::vector<std::uint32_t> m_freeEntities;
+		std::size_t m_size;
+		ComponentStore<Collidable> m_collidables;
+		ComponentStore<sf::Vector2f> m_velocities;
+		ComponentStore<RenderComponent> m_renderComponents;
+		SpatialHash<std::uint32_t> m_obstacles;
+		bool m_obstaclesChanged;
+		std::vector<std::uint32_t> m_candidates;
+		mutable std::vector<const sf::Texture *> m_textures;
+		mutable std::vector<std::size_t> m_counts;
+		mutable std::vector<VertexBatch> m_batches;
+		mutable std::vector<sf::Vertex *> m_cursors;
+	public:
+		// Constructors
+		explicit EntityWorld(float cellSize = 64.f) : m_size(0), m_obstacles(cellSize), m_obstaclesChanged(false)
+		{
+			// The cell size of the obstacle broad phase should be about the size of a typical obstacle
+		}
+		// Destructor
+		~EntityWorld()
+		{
+		}
+		// Accessors
+		std::size_t                             size                  () const
+		{
+			// Returns the number of entities that are alive
+			return m_size;
+		}
+		bool                                    isAlive               (EntityHandle entity) const
+		{
+			// Returns true if the entity has been created and not destroyed
+			return entity.index < m_generations.size() && m_generations[entity.index] == entity.generation;
+		}
+		Collidable *                            getCollidable         (EntityHandle entity)
+		{
+			// Returns the entity's collidable, or nullptr if it does not have one
+			return isAlive(entity) ? m_collidables.get(entity.index) : nullptr;
+		}
+		sf::Vector2f *                          getVelocity           (EntityHandle entity)
+		{
+			// Returns the entity's velocity, or nullptr if it does not move
+			return isAlive(entity) ? m_velocities.get(entity.index) : nullptr;
+		}
+		RenderComponent *                       getRenderComponent    (EntityHandle entity)
+		{
+			// Returns the entity's render component, or nullptr if it is not drawn
+			return isAlive(entity) ? m_renderComponents.get(entity.index) : nullptr;
+		}
+		const ComponentStore<Collidable> &      getCollidables        () const
+		{
+			return m_collidables;
+		}
+		const ComponentStore<sf::Vector2f> &    getVelocities         () const
+		{
+			return m_velocities;
+		}
+		const ComponentStore<RenderComponent> & getRenderComponents   () const
+		{
+			return m_renderComponents;
+		}
+		// Mutators
+		EntityHandle create            ()
+		{
+			// Create an entity without any components
+			std::uint32_t index;
+			if (m_freeEntities.empty())
+			{
+				index = static_cast<std::uint32_t>(m_generations.size());
+				m_generations.push_back(1);
+			}
+			else
+			{
+				index = m_freeEntities.back();
+				m_freeEntities.pop_back();
+			}
+			++m_size;
+			return EntityHandle(index, m_generations[index]);
+		}
+		bool         destroy           (EntityHandle entity)
+		{
+			// Destroy an entity and all of its components
+			// Returns false if the entity was already destroyed
+			if (!isAlive(entity))
+				return false;
+			removeCollidable(entity);
+			removeVelocity(entity);
+			removeRenderComponent(entity);
+			if (++m_generations[entity.index] == 0)
+				m_generations[entity.index] = 1;
+			m_freeEntities.push_back(entity.index);
+			--m_size;
+			return true;
+		}
+		void         reserve           (std::size_t count)
+		{
+			// Allocate room for count entities with every component
+			m_generations.reserve(count);
+			m_collidables.reserve(count);
+			m_velocities.reserve(count);
+			m_renderComponents.reserve(count);
+		}
+		void         setCollidable     (EntityHandle entity, const Collidable & collidable)
+		{
+			if (!isAlive(entity))
+				return;
+			m_collidables.add(entity.index, collidable);
+			if (!m_velocities.has(entity.index))
+				m_obstaclesChanged = true;
+		}
+		void         setVelocity       (EntityHandle entity, const sf::Vector2f & velocity)
+		{
+			if (!isAlive(entity))
+				return;
+			if (!m_velocities.has(entity.index) && m_collidables.has(entity.index))
+				m_obstaclesChanged = true;
+			m_velocities.add(entity.index, velocity);
+		}
+		void         setRenderComponent(EntityHandle entity, const RenderComponent & renderComponent)
+		{
+			if (isAlive(entity))
+				m_renderComponents.add(entity.index, renderComponent);
+		}
+		void         removeCollidable  (EntityHandle entity)
+		{
+			if (isAlive(entity) && m_collidables.remove(entity.index) && !m_velocities.has(entity.index))
+				m_obstaclesChanged = true;
+		}
+		void         removeVelocity    (EntityHandle entity)
+		{
+			if (isAlive(entity) && m_velocities.remove(entity.index) && m_collidables.has(entity.index))
+				m_obstaclesChanged = true;
+		}
+		void         removeRenderComponent(EntityHandle entity)
+		{
+			if (isAlive(entity))
+				m_renderComponents.remove(entity.index);
+		}
+		void         invalidateObstacles()
+		{
+			// Rebuild the obstacle broad phase before the next call to handleIntersections
+			m_obstaclesChanged = true;
+		}
+		// Systems
+		void accelerate         (const sf::Vector2f & force, sf::Time elapsed)
+		{
+			// Change the velocity of every moving entity by a force vector
+			const sf::Vector2f change = force * elapsed.asSeconds();
+			sf::Vector2f * velocities = m_velocities.data();
+			for (std::size_t i = 0; i < m_velocities.size(); ++i)
+				velocities[i] += change;
+		}
+		void move               (sf::Time elapsed)
+		{
+			// Move every entity that has both a velocity and a collidable
+			const float seconds = elapsed.asSeconds();
+			const sf::Vector2f * velocities = m_velocities.data();
+			const std::uint32_t * entities = m_velocities.entities();
+			for (std::size_t i = 0; i < m_velocities.size(); ++i)
+			{
+				Collidable * collidable = m_collidables.get(entities[i]);
+				if (collidable != nullptr)
+					collidable->move(velocities[i] * seconds);
+			}
+		}
+		void handleIntersections()
+		{
+			// Push every moving entity out of the obstacles it intersects, in the same way as Entity::handleIntersection
+			// The obstacles that a moving entity intersects are handled in the order the obstacles were created
+			if (m_obstaclesChanged)
+				rebuildObstacles();
+			sf::Vector2f * velocities = m_velocities.data();
+			const std::uint32_t * entities = m_velocities.entities();
+			for (std::size_t i = 0; i < m_velocities.size(); ++i)
+			{
+				Collidable * collidable = m_collidables.get(entities[i]);
+				if (collidable == nullptr)
+					continue;
+				m_candidates.clear();
+				m_obstacles.query(collidable->getBoundingBox(), m_candidates);
+				std::sort(m_candidates.begin(), m_candidates.end());
+				for (std::uint32_t obstacle : m_candidates)
+				{
+					const Collidable & other = *m_collidables.get(obstacle);
+					if (collidable->intersects(other))
+						resolveIntersection(*collidable, velocities[i], other);
+				}
+			}
+		}
+		virtual void draw       (sf::RenderTarget & target, sf::RenderStates states = sf::RenderStates::Default) const
+		{
+			// Draw every entity that has both a render component and a collidable
+			// The quads are batched by texture, so there is one draw call per texture instead of one per entity
+			// Quads with the same texture are drawn in component order, and the batches in the order their textures were
+			// first drawn. The batch of a texture that a frame does not draw is freed at the end of that frame
+			const RenderComponent * renderComponents = m_renderComponents.data();
+			const std::uint32_t * entities = m_renderComponents.entities();
+			m_counts.assign(m_textures.size(), 0);
+			for (std::size_t i = 0; i < m_renderComponents.size(); ++i)
+				if (m_collidables.has(entities[i]))
+					++m_counts[batchIndex(renderComponents[i].texture)];
+			m_cursors.resize(m_batches.size());
+			for (std::size_t batch = 0; batch < m_batches.size(); ++batch)
+				m_cursors[batch] = m_batches[batch].resize(m_counts[batch] * 4);
+			for (std::size_t i = 0; i < m_renderComponents.size(); ++i)
+			{
+				const Collidable * collidable = m_collidables.get(entities[i]);
+				if (collidable == nullptr)
+					continue;
+				const RenderComponent & renderComponent = renderComponents[i];
+				sf::Vertex *& quad = m_cursors[batchIndex(renderComponent.texture)];
+				writeQuad(quad, collidable->getBoundingBox(), renderComponent);
+				quad += 4;
+			}
+			for (std::size_t batch = 0; batch < m_batches.size(); ++batch)
+			{
+				if (m_counts[batch] == 0)
+					continue;
+				sf::RenderStates batchStates = states;
+				batchStates.texture = m_textures[batch];
+				target.draw(m_batches[batch], batchStates);
+			}
+			pruneBatches();
+		}
+	private:
+		void rebuildObstacles()
+		{
+			// Put every entity that has a collidable but no velocity into the obstacle broad phase
+			m_obstacles.clear();
+			const Collidable * collidables = m_collidables.data();
+			const std::uint32_t * entities = m_collidables.entities();
+			for (std::size_t i = 0; i < m_collidables.size(); ++i)
+				if (!m_velocities.has(entities[i]))
+					m_obstacles.insert(entities[i], collidables[i].getBoundingBox());
+			m_obstaclesChanged = false;
+		}
+		std::size_t batchIndex(const sf::Texture * texture) const
+		{
+			// Returns the batch that quads with the given texture are written to, adding one for a new texture
+			// Scenes only use a handful of textures, so a linear search is fine
+			for (std::size_t i = 0; i < m_textures.size(); ++i)
+				if (m_textures[i] == texture)
+					return i;
+			m_textures.push_back(texture);
+			m_counts.push_back(0);
+			m_batches.emplace_back(sf::PrimitiveType::Quads);
+			return m_textures.size() - 1;
+		}
+		void pruneBatches() const
+		{
+			// Free the batches of textures that the frame did not draw, keeping the others in order
+			std::size_t kept = 0;
+			for (std::size_t batch = 0; batch < m_batches.size(); ++batch)
+			{
+				if (m_counts[batch] == 0)
+					continue;
+				if (kept != batch)
+				{
+					m_textures[kept] = m_textures[batch];
+					m_counts[kept] = m_counts[batch];
+					std::swap(m_batches[kept], m_batches[batch]);
+				}
+				++kept;
+			}
+			m_textures.resize(kept);
+			m_counts.resize(kept);
+			m_batches.erase(m_batches.begin() + kept, m_batches.end());
+		}
+		static void writeQuad(sf::Vertex * quad, const sf::FloatRect & bounds, const RenderComponent & renderComponent)
+		{
+			// Write the four corners of an entity, clockwise from the top left like Entity::updateVertices
+			sf::FloatRect rect = renderComponent.textureRect;
+			if (rect.width == 0.f && rect.height == 0.f)
+				rect = sf::FloatRect(0.f, 0.f, bounds.width, bounds.height);
+			quad[0] = sf::Vertex(sf::Vector2f(bounds.left, bounds.top), renderComponent.color, sf::Vector2f(rect.left, rect.top));
+			quad[1] = sf::Vertex(sf::Vector2f(bounds.left + bounds.width, bounds.top), renderComponent.color, sf::Vector2f(rect.left + rect.width, rect.top));
+			quad[2] = sf::Vertex(sf::Vector2f(bounds.left + bounds.width, bounds.top + bounds.height), renderComponent.color, sf::Vector2f(rect.left + rect.width, rect.top + rect.height));
+			quad[3] = sf::Vertex(sf::Vector2f(bounds.left, bounds.top + bounds.height), renderComponent.color, sf::Vector2f(rect.left, rect.top + rect.height));
+		}
+	};
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <SFML/System/Time.hpp>
+#include <SFML/System/Vector2.hpp>
+
+#include "FlexibleClock.hpp"
+
+// The FixedTimestep class drives a simulation at a constant rate, independent of how often frames are drawn.
+
+// Every frame, advance measures how much time has passed on a FlexibleClock and adds it to an accumulator. The step
+// function is then called with the fixed step for as long as a whole step fits in the accumulator. Whatever is left
+// over is carried into the next frame, and getAlpha reports how far between the last two steps the frame falls, so
+// the renderer can interpolate between the previous and the current state instead of showing the simulation stutter.
+
+// The number of steps per frame is capped. After a long hitch (a breakpoint, loading, dragging the window) the excess
+// time is dropped instead of being simulated all at once, so the simulation slows down for a frame instead of taking
+// ever longer to catch up. Pausing or scaling the clock pauses or scales the simulation. Steps shorter than a
+// microsecond, the resolution of sf::Time, are lengthened to a microsecond.
+
+// Because each step is always the same length, Entity::update, ParticleSystem::step and the like behave the same way
+// on every machine, and a Tweener can be kept in lockstep by passing getSimulatedTime to its setCurrentTime.
+
+// TODO: tests
+
+namespace sfext
+{
+	sf::Vector2f interpolate(const sf::Vector2f & previous, const sf::Vector2f & current, float alpha)
+	{
+		// Returns the point alpha of the way from previous to current
+		return previous + (current - previous) * alpha;
+	}
+
+	class FixedTimestep final
+	{
+	private:
+		FlexibleClock m_clock;
+		sf::Time m_step;
+		sf::Time m_accumulator;
+		sf::Time m_lastTime;
+		sf::Time m_simulatedTime;
+		sf::Time m_droppedTime;
+		unsigned int m_maximumSteps;
+	public:
+		// Constructors
+		explicit FixedTimestep(sf::Time step = sf::seconds(1.f / 60.f), unsigned int maximumSteps = 8) : m_step(clampStep(step)), m_accumulator(sf::Time::Zero), m_lastTime(sf::Time::Zero), m_simulatedTime(sf::Time::Zero), m_droppedTime(sf::Time::Zero), m_maximumSteps(maximumSteps ? maximumSteps : 1)
+		{
+		}
+		// Destructor
+		~FixedTimestep()
+		{
+		}
+		// Accessors
+		sf::Time              getStep         () const
+		{
+			return m_step;
+		}
+		unsigned int          getMaximumSteps () const
+		{
+			return m_maximumSteps;
+		}
+		float                 getAlpha        () const
+		{
+			// Returns how far the current frame is between the previous step and the next one, in [0, 1)
+			return m_accumulator.asSeconds() / m_step.asSeconds();
+		}
+		sf::Time              getSimulatedTime() const
+		{
+			// Returns the total time that has been simulated, which is always a whole number of steps
+			return m_simulatedTime;
+		}
+		sf::Time              getDroppedTime  () const
+		{
+			// Returns the total time that was thrown away because a frame needed more than the maximum number of steps
+			return m_droppedTime;
+		}
+		FlexibleClock &       getClock        ()
+		{
+			// The clock can be paused, or its modifier changed for slow motion
+			return m_clock;
+		}
+		const FlexibleClock & getClock        () const
+		{
+			return m_clock;
+		}
+		// Mutators
+		void setStep        (sf::Time step)
+		{
+			m_step = clampStep(step);
+		}
+		void setMaximumSteps(unsigned int maximumSteps)
+		{
+			m_maximumSteps = maximumSteps ? maximumSteps : 1;
+		}
+		// Utilities
+		template <typename StepFunction>
+		unsigned int advance(StepFunction step)
+		{
+			// Call step(getStep()) once for every whole step of time that has passed since the last call
+			// Returns the number of steps that were taken
+			sf::Time now = m_clock.getElapsedTime();
+			m_accumulator += now - m_lastTime;
+			m_lastTime = now;
+			unsigned int steps = 0;
+			while (m_accumulator >= m_step && steps < m_maximumSteps)
+			{
+				step(m_step);
+				m_accumulator -= m_step;
+				m_simulatedTime += m_step;
+				++steps;
+			}
+			if (m_accumulator >= m_step)
+			{
+				// Keep the fraction of a step so that getAlpha stays meaningful, and drop the rest
+				sf::Time remainder = sf::microseconds(m_accumulator.asMicroseconds() % m_step.asMicroseconds());
+				m_droppedTime += m_accumulator - remainder;
+				m_accumulator = remainder;
+			}
+			return steps;
+		}
+		void         reset  ()
+		{
+			// Forget all accumulated time, e.g. after a level has loaded
+			m_clock.restart();
+			m_accumulator = sf::Time::Zero;
+			m_lastTime = sf::Time::Zero;
+		}
+	private:
+		static sf::Time clampStep(sf::Time step)
+		{
+			// Returns the step, lengthened to a microsecond if it is shorter
+			return step < sf::microseconds(1) ? sf::microseconds(1) : step;
+		}
+	};
+}
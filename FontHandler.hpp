@@ -1,10 +1,15 @@
 #pragma once
 
 #include <map>
+#include <memory>
+#include <vector>
 
 #include <SFML/Graphics/Font.hpp>
 #include <SFML/System/String.hpp>
 
+// A font loaded from memory keeps reading from that memory for as long as it is used, so fonts that are added from a
+// buffer (which is how AsyncLoader hands them over) share ownership of it. Copies of the handler share the buffers too.
+
 // TODO: tests
 // TODO: documentation
 
@@ -14,12 +19,13 @@ namespace sfext
 	{
 	private:
 		std::map<sf::String, sf::Font> m_fonts;
+		std::map<sf::String, std::shared_ptr<const std::vector<char>>> m_fontData;
 	public:
 		// Constructors
 		FontHandler()
 		{
 		}
-		FontHandler(const FontHandler & rhs) : m_fonts(rhs.m_fonts)
+		FontHandler(const FontHandler & rhs) : m_fonts(rhs.m_fonts), m_fontData(rhs.m_fontData)
 		{
 		}
 		// Destructor
@@ -41,6 +47,19 @@ namespace sfext
 			if (font.loadFromFile(filePath))
 			{
 				m_fonts[fontAlias] = font;
+				m_fontData.erase(fontAlias);
+				return true;
+			}
+			return false;
+		}
+		bool        addFont   (const std::shared_ptr<const std::vector<char>> & fileData, const sf::String & fontAlias)
+		{
+			// Add a font from the contents of a font file, which the handler keeps alive for as long as the font exists
+			sf::Font font;
+			if (fileData && font.loadFromMemory(fileData->data(), fileData->size()))
+			{
+				m_fonts[fontAlias] = font;
+				m_fontData[fontAlias] = fileData;
 				return true;
 			}
 			return false;
@@ -55,6 +74,7 @@ namespace sfext
 			if (font != m_fonts.cend())
 			{
 				m_fonts.erase(font);
+				m_fontData.erase(fontAlias);
 				return true;
 			}
 			return false;
@@ -6,13 +6,19 @@
 #include "SpriteHandler.hpp"
 #include "AnimationHandler.hpp"
 #include "FontHandler.hpp"
+#include "TextureCache.hpp"
 #include "FileWrapper.hpp"
 
 // The Global Resource Cache provides a way to access resources such as textures, fonts, sprites, and animations.
 // It also provides global access to a debugging tool.
 
 // The resources that are stored are persistent throughout the lifetime of the application, only being deleted when
-// either the application closes or the program explicitly requests that they be deallocated.
+// either the application closes or the program explicitly requests that they be deallocated. The one exception is the
+// TextureCache, which evicts textures that nothing references once its memory budget is exceeded, and loads them
+// again the next time they are accessed. Long sessions that stream through many textures should load them there.
+
+// The texture, sprite and animation handlers get their textures from the same TextureStore, so an image that is
+// loaded into more than one of them is still only decoded and uploaded once.
 
 // The primary benefit of storing resources in a globally accessible but strongly controlled container is that
 // commonly accessed resources are available throughout the application and do not need to be passed around to
@@ -39,6 +45,7 @@ namespace sfext
 	{
 	private:
 		static TextureHandler m_texture_handler;
+		static TextureCache m_texture_cache;
 		static FontHandler m_font_handler;
 		static AnimationHandler m_animation_handler;
 		static SpriteHandler m_sprite_handler;
@@ -54,6 +61,20 @@ namespace sfext
 			// TextureHandler, see TextureHandler.hpp
 			return m_texture_handler;
 		}
+		static TextureCache & getTextureCache()
+		{
+			// Returns a reference to the global TextureCache instance.
+			// For more information on the implementation and usage of the
+			// TextureCache, see TextureCache.hpp
+			return m_texture_cache;
+		}
+		static TextureStore & getTextureStore()
+		{
+			// Returns a reference to the TextureStore that every handler shares.
+			// For more information on the implementation and usage of the
+			// TextureStore, see TextureStore.hpp
+			return TextureStore::getGlobal();
+		}
 		static FontHandler & getFontHandler()
 		{
 			// Returns a reference to the global FontHandler instance.
@@ -106,6 +127,7 @@ namespace sfext
 	};
 
 	TextureHandler GlobalResourceCache::m_texture_handler = TextureHandler();
+	TextureCache GlobalResourceCache::m_texture_cache;
 	FontHandler GlobalResourceCache::m_font_handler = FontHandler();
 	AnimationHandler GlobalResourceCache::m_animation_handler = AnimationHandler();
 	SpriteHandler GlobalResourceCache::m_sprite_handler = SpriteHandler();
@@ -1,8 +1,12 @@
 #pragma once
 
 #include <SFML/Graphics/Drawable.hpp>
+#include <SFML/Graphics/VertexArray.hpp>
 #include <SFML/System/Time.hpp>
 
+#include <algorithm>
+#include <cstddef>
+
 // TODO: tests
 
 namespace sfext
@@ -107,6 +111,21 @@ namespace sfext
 			// Overwrite this with the rendering code for Particle subclasses
 			vertices.append(sf::Vertex(m_position, sf::Color::White));
 		}
+		virtual void writeVertices(sf::Vertex * vertices, std::size_t count) const
+		{
+			// Write the particle's batching vertices into an already sized range of count vertices
+			// count is the getPointCount() of the particle type, and exactly that many vertices must be written
+			// Overwrite this along with addToBatch for Particle subclasses; by default the vertices that addToBatch
+			// appends are copied over, so subclasses that only overwrite addToBatch still draw correctly
+			// Extra vertices from addToBatch are dropped, and missing ones are written as transparent points
+			thread_local sf::VertexArray scratch;
+			scratch.clear();
+			addToBatch(scratch);
+			std::size_t copied = std::min<std::size_t>(scratch.getVertexCount(), count);
+			for (std::size_t i = 0; i < copied; ++i)
+				vertices[i] = scratch[i];
+			std::fill(vertices + copied, vertices + count, sf::Vertex(m_position, sf::Color::Transparent));
+		}
 		// Static Functions
 		static sf::PrimitiveType getPrimitiveType()
 		{
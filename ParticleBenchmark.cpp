@@ -0,0 +1,87 @@
+// Headless particle benchmark
+// Usage: ParticleBenchmark [--frames N] [--all] [particle counts...]
+// Prints the per-phase cost of ParticleSystem<ColoredParticle, ColoredParticleFactory> for each particle count
+// (10000 and 100000 by default), along with how many heap allocations each phase makes per frame
+// With --all, the compaction, kernel, and sort benchmarks are run as well
+
+#include "ParticleBenchmark.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <string>
+
+namespace
+{
+	std::atomic<std::size_t> allocationCount(0);
+
+	std::size_t countAllocations()
+	{
+		// Returns the number of times the global operator new has been called so far
+		return allocationCount.load(std::memory_order_relaxed);
+	}
+}
+
+// Every heap allocation in the program goes through these, so that the benchmarks can count them
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete" // GCC does not know that these replace the global operators
+#endif
+void * operator new(std::size_t size)
+{
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	if (void * memory = std::malloc(size ? size : 1))
+		return memory;
+	throw std::bad_alloc();
+}
+void * operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+void operator delete(void * memory) noexcept
+{
+	std::free(memory);
+}
+void operator delete[](void * memory) noexcept
+{
+	operator delete(memory);
+}
+void operator delete(void * memory, std::size_t) noexcept
+{
+	operator delete(memory);
+}
+void operator delete[](void * memory, std::size_t) noexcept
+{
+	operator delete(memory);
+}
+
+int main(int argc, char * argv[])
+{
+	std::vector<std::size_t> counts;
+	unsigned int frames = 300;
+	bool all = false;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+			frames = static_cast<unsigned int>(std::stoul(argv[++i]));
+		else if (std::strcmp(argv[i], "--all") == 0)
+			all = true;
+		else
+			counts.push_back(static_cast<std::size_t>(std::stoull(argv[i])));
+	}
+	if (counts.empty())
+		counts = { 10000, 100000 };
+
+	sfext::printPhaseBenchmarks(std::cout, counts, frames, countAllocations);
+	if (all)
+	{
+		std::cout << std::endl;
+		sfext::printCompactionBenchmarks(std::cout);
+		std::cout << std::endl;
+		sfext::printKernelBenchmarks(std::cout);
+		std::cout << std::endl;
+		sfext::printSortBenchmarks(std::cout);
+	}
+	return 0;
+}
@@ -0,0 +1,339 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <ostream>
+#include <vector>
+
+#include "ColoredParticle.hpp"
+#include "ParticleSystem.hpp"
+#include "ContiguousParticleSystem.hpp"
+
+// The particle benchmarks measure how long the particle systems take to perform their per-frame work.
+
+// Every benchmark is headless: nothing is drawn to a window, so they can be run from any test program or build
+// machine. Results are reported in milliseconds of wall clock time.
+
+// TODO: tests
+
+namespace sfext
+{
+	namespace PBPF // ParticleBenchmarkPrivateFunctions
+	{
+		typedef std::chrono::steady_clock Clock;
+
+		double millisecondsSince(Clock::time_point start)
+		{
+			// Returns the number of milliseconds that have passed since start
+			return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		}
+	}
+
+	class BenchmarkParticleFactory final
+	{
+		// Creates particles whose lifespans make a fixed fraction of them dead after aging for one second
+		// The dead particles are spread evenly through the system, which is the worst case for compaction
+	private:
+		mutable std::size_t m_created;
+		double m_deadFraction;
+	public:
+		// Constructor
+		explicit BenchmarkParticleFactory(double deadFraction = .5) : m_created(0), m_deadFraction(deadFraction)
+		{
+		}
+		// Creator Functions
+		ColoredParticle * create() const
+		{
+			return new ColoredParticle(nextPosition(), sf::Vector2f(1.f, 1.f), nextLifespan(), sf::Color::White);
+		}
+		ColoredParticle * create(ParticlePool<ColoredParticle> & pool) const
+		{
+			return pool.create(nextPosition(), sf::Vector2f(1.f, 1.f), nextLifespan(), sf::Color::White);
+		}
+		void              create(ParticleBuffer & particles) const
+		{
+			particles.add(nextPosition(), sf::Vector2f(1.f, 1.f), nextLifespan(), sf::Color::White);
+		}
+		std::size_t       createBatch(std::size_t n, ParticlePool<ColoredParticle> & pool, std::vector<ColoredParticle *> & particles) const
+		{
+			std::size_t created = 0;
+			for (; created < n; ++created)
+			{
+				ColoredParticle * particle = create(pool);
+				if (particle == nullptr)
+					break;
+				particles.push_back(particle);
+			}
+			return created;
+		}
+		void              createBatch(std::size_t n, ParticleBuffer & particles) const
+		{
+			for (std::size_t i = 0; i < n; ++i)
+				create(particles);
+		}
+	private:
+		sf::Vector2f nextPosition() const
+		{
+			return sf::Vector2f(static_cast<float>(m_created % 1024), static_cast<float>(m_created / 1024));
+		}
+		sf::Time     nextLifespan() const
+		{
+			// Particle i dies if the running total of dead particles increases when it is created
+			std::size_t index = m_created++;
+			bool dead = static_cast<std::size_t>((index + 1) * m_deadFraction) > static_cast<std::size_t>(index * m_deadFraction);
+			return dead ? sf::seconds(.5f) : sf::seconds(2.f);
+		}
+	};
+
+	struct CompactionBenchmark
+	{
+		std::size_t particles;
+		double stableMilliseconds;
+		double unorderedMilliseconds;
+		double contiguousStableMilliseconds;
+		double contiguousUnorderedMilliseconds;
+	};
+
+	template <typename System>
+	double benchmarkCompaction(std::size_t particles, double deadFraction, ParticleCompaction compaction)
+	{
+		// Times a single call to deleteDeadParticles on a freshly filled system
+		BenchmarkParticleFactory factory(deadFraction);
+		System system(factory);
+		system.add(static_cast<unsigned int>(particles));
+		system.age(sf::seconds(1.f));
+		PBPF::Clock::time_point start = PBPF::Clock::now();
+		system.deleteDeadParticles(compaction);
+		return PBPF::millisecondsSince(start);
+	}
+
+	CompactionBenchmark benchmarkCompaction(std::size_t particles, double deadFraction = .5)
+	{
+		// Times both compaction policies for both kinds of particle system
+		typedef ParticleSystem<ColoredParticle, BenchmarkParticleFactory> PointerSystem;
+		typedef ContiguousParticleSystem<BenchmarkParticleFactory> ContiguousSystem;
+		CompactionBenchmark result;
+		result.particles = particles;
+		result.stableMilliseconds = benchmarkCompaction<PointerSystem>(particles, deadFraction, ParticleCompaction::Stable);
+		result.unorderedMilliseconds = benchmarkCompaction<PointerSystem>(particles, deadFraction, ParticleCompaction::Unordered);
+		result.contiguousStableMilliseconds = benchmarkCompaction<ContiguousSystem>(particles, deadFraction, ParticleCompaction::Stable);
+		result.contiguousUnorderedMilliseconds = benchmarkCompaction<ContiguousSystem>(particles, deadFraction, ParticleCompaction::Unordered);
+		return result;
+	}
+
+	void printCompactionBenchmarks(std::ostream & ostr, const std::vector<std::size_t> & counts = { 10000, 100000, 1000000 })
+	{
+		// Writes the compaction timings for each particle count, with half of the particles dead
+		ostr << "deleteDeadParticles (50% dead), milliseconds" << std::endl;
+		ostr << "particles\tstable\tunordered\tcontiguous stable\tcontiguous unordered" << std::endl;
+		for (std::size_t count : counts)
+		{
+			CompactionBenchmark result = benchmarkCompaction(count);
+			ostr << result.particles << '\t' << result.stableMilliseconds << '\t' << result.unorderedMilliseconds << '\t'
+				 << result.contiguousStableMilliseconds << '\t' << result.contiguousUnorderedMilliseconds << std::endl;
+		}
+	}
+
+	struct KernelBenchmark
+	{
+		ParticleKernelPath path;
+		bool supported;
+		double particlesPerMillisecond;
+	};
+
+	KernelBenchmark benchmarkKernels(ParticleKernelPath path, std::size_t particles, unsigned int frames = 100)
+	{
+		// Times accelerate, move, and age on a ParticleBuffer that is forced onto a single kernel path
+		// Nobody dies during the run, so only the integration kernels are measured
+		KernelBenchmark result;
+		result.path = path;
+		result.supported = isParticleKernelPathSupported(path);
+		result.particlesPerMillisecond = 0.0;
+		if (!result.supported || particles == 0 || frames == 0)
+			return result;
+		BenchmarkParticleFactory factory(0.0);
+		ParticleBuffer buffer(particles);
+		buffer.setKernelPath(path);
+		for (std::size_t i = 0; i < particles; ++i)
+			factory.create(buffer);
+		sf::Time elapsed = sf::microseconds(1);
+		PBPF::Clock::time_point start = PBPF::Clock::now();
+		for (unsigned int frame = 0; frame < frames; ++frame)
+		{
+			buffer.accelerate(sf::Vector2f(0.f, 9.8f), elapsed);
+			buffer.move(elapsed);
+			buffer.age(elapsed);
+		}
+		result.particlesPerMillisecond = static_cast<double>(particles) * frames / PBPF::millisecondsSince(start);
+		return result;
+	}
+
+	void printKernelBenchmarks(std::ostream & ostr, std::size_t particles = 1000000)
+	{
+		// Writes the integration throughput of every kernel path
+		const char * names[] = { "scalar", "sse2", "avx2" };
+		const ParticleKernelPath paths[] = { ParticleKernelPath::Scalar, ParticleKernelPath::SSE2, ParticleKernelPath::AVX2 };
+		ostr << "accelerate + move + age (" << particles << " particles), particles per millisecond" << std::endl;
+		for (unsigned int i = 0; i < 3; ++i)
+		{
+			KernelBenchmark result = benchmarkKernels(paths[i], particles);
+			ostr << names[i] << '\t';
+			if (result.supported)
+				ostr << result.particlesPerMillisecond << std::endl;
+			else
+				ostr << "unsupported" << std::endl;
+		}
+	}
+
+	struct SortBenchmark
+	{
+		std::size_t particles;
+		double firstMilliseconds;
+		double frameMilliseconds;
+		double contiguousFirstMilliseconds;
+		double contiguousFrameMilliseconds;
+	};
+
+	template <typename System>
+	void benchmarkSorting(std::size_t particles, unsigned int frames, double & firstMilliseconds, double & frameMilliseconds)
+	{
+		// Times the first depth sort of a freshly spawned burst, and then the average sort per frame while it spreads out
+		// Only the sort is timed; the particles are moved between sorts without being timed
+		ColoredParticleFactory factory(sf::Vector2f(0.f, 0.f), sf::Vector2f(0.f, 100.f), sf::seconds(1000.f), sf::Color::White, 500.f);
+		System system(factory);
+		system.add(static_cast<unsigned int>(particles));
+		system.setSorting(ParticleSortKey::Depth);
+		PBPF::Clock::time_point start = PBPF::Clock::now();
+		system.sort();
+		firstMilliseconds = PBPF::millisecondsSince(start);
+		frameMilliseconds = 0.0;
+		for (unsigned int frame = 0; frame < frames; ++frame)
+		{
+			system.move(sf::seconds(1.f / 60.f));
+			start = PBPF::Clock::now();
+			system.sort();
+			frameMilliseconds += PBPF::millisecondsSince(start);
+		}
+		if (frames > 0)
+			frameMilliseconds /= frames;
+	}
+
+	SortBenchmark benchmarkSorting(std::size_t particles = 100000, unsigned int frames = 100)
+	{
+		// Times the sort stage of both kinds of particle system
+		SortBenchmark result;
+		result.particles = particles;
+		benchmarkSorting<ParticleSystem<ColoredParticle, ColoredParticleFactory>>(particles, frames, result.firstMilliseconds, result.frameMilliseconds);
+		benchmarkSorting<ContiguousParticleSystem<ColoredParticleFactory>>(particles, frames, result.contiguousFirstMilliseconds, result.contiguousFrameMilliseconds);
+		return result;
+	}
+
+	void printSortBenchmarks(std::ostream & ostr, std::size_t particles = 100000)
+	{
+		// Writes the cost of sorting the particles by depth, both from scratch and per frame once they are sorted
+		SortBenchmark result = benchmarkSorting(particles);
+		ostr << "sort by depth (" << result.particles << " particles), milliseconds" << std::endl;
+		ostr << "system\tfirst sort\tper frame" << std::endl;
+		ostr << "pointer\t" << result.firstMilliseconds << '\t' << result.frameMilliseconds << std::endl;
+		ostr << "contiguous\t" << result.contiguousFirstMilliseconds << '\t' << result.contiguousFrameMilliseconds << std::endl;
+	}
+
+	struct PhaseBenchmark
+	{
+		// Nanoseconds per particle and heap allocations per frame for each phase of a frame
+		std::size_t particles;
+		unsigned int frames;
+		double spawnNanoseconds;
+		double updateNanoseconds;
+		double cullNanoseconds;
+		double batchNanoseconds;
+		double spawnAllocations;
+		double updateAllocations;
+		double cullAllocations;
+		double batchAllocations;
+	};
+
+	PhaseBenchmark benchmarkPhases(std::size_t particles, unsigned int frames = 300, const std::function<std::size_t()> & allocations = std::function<std::size_t()>())
+	{
+		// Runs a ParticleSystem<ColoredParticle, ColoredParticleFactory> through spawn, update, cull, and batch cycles
+		// Particles live for one second of 60 Hz frames and a sixtieth of them is spawned every frame, so after one
+		// second of warm up the system holds about the requested number of particles
+		// Vertices are written into the draw batch but never drawn, so no window or OpenGL context is needed
+		// If allocations is given, it must return the number of heap allocations made so far; it is sampled around
+		// every phase
+		const unsigned int lifespanFrames = 60;
+		const sf::Time elapsed = sf::seconds(1.f / lifespanFrames);
+		const unsigned int spawnCount = static_cast<unsigned int>(std::max<std::size_t>(particles / lifespanFrames, 1));
+		ColoredParticleFactory factory(sf::Vector2f(0.f, 0.f), sf::Vector2f(0.f, 100.f), elapsed * static_cast<float>(lifespanFrames), sf::Color::White, 50.f);
+		ParticleSystem<ColoredParticle, ColoredParticleFactory> system(factory, particles + spawnCount);
+		WorkerPool batcher(1); // Writes the batch on the calling thread only
+		PhaseBenchmark result = PhaseBenchmark();
+		result.particles = particles;
+		result.frames = frames;
+		double spawned = 0.0;
+		double processed = 0.0;
+		for (unsigned int frame = 0; frame < lifespanFrames + frames; ++frame)
+		{
+			const bool measured = frame >= lifespanFrames;
+			std::size_t allocationsBefore = allocations ? allocations() : 0;
+			PBPF::Clock::time_point start = PBPF::Clock::now();
+			system.add(spawnCount);
+			double spawnMilliseconds = PBPF::millisecondsSince(start);
+			std::size_t allocationsAfterSpawn = allocations ? allocations() : 0;
+			start = PBPF::Clock::now();
+			system.accelerate(sf::Vector2f(0.f, 9.8f), elapsed);
+			system.move(elapsed);
+			system.age(elapsed);
+			double updateMilliseconds = PBPF::millisecondsSince(start);
+			std::size_t allocationsAfterUpdate = allocations ? allocations() : 0;
+			const std::size_t population = system.size();
+			start = PBPF::Clock::now();
+			system.deleteDeadParticles();
+			double cullMilliseconds = PBPF::millisecondsSince(start);
+			std::size_t allocationsAfterCull = allocations ? allocations() : 0;
+			start = PBPF::Clock::now();
+			system.batch(batcher);
+			double batchMilliseconds = PBPF::millisecondsSince(start);
+			std::size_t allocationsAfterBatch = allocations ? allocations() : 0;
+			if (!measured)
+				continue;
+			spawned += spawnCount;
+			processed += static_cast<double>(population);
+			result.spawnNanoseconds += spawnMilliseconds * 1e6;
+			result.updateNanoseconds += updateMilliseconds * 1e6;
+			result.cullNanoseconds += cullMilliseconds * 1e6;
+			result.batchNanoseconds += batchMilliseconds * 1e6;
+			result.spawnAllocations += static_cast<double>(allocationsAfterSpawn - allocationsBefore);
+			result.updateAllocations += static_cast<double>(allocationsAfterUpdate - allocationsAfterSpawn);
+			result.cullAllocations += static_cast<double>(allocationsAfterCull - allocationsAfterUpdate);
+			result.batchAllocations += static_cast<double>(allocationsAfterBatch - allocationsAfterCull);
+		}
+		if (frames == 0 || processed == 0.0)
+			return result;
+		result.spawnNanoseconds /= spawned;
+		result.updateNanoseconds /= processed;
+		result.cullNanoseconds /= processed;
+		result.batchNanoseconds /= processed;
+		result.spawnAllocations /= frames;
+		result.updateAllocations /= frames;
+		result.cullAllocations /= frames;
+		result.batchAllocations /= frames;
+		return result;
+	}
+
+	void printPhaseBenchmarks(std::ostream & ostr, const std::vector<std::size_t> & counts = { 10000, 100000 }, unsigned int frames = 300, const std::function<std::size_t()> & allocations = std::function<std::size_t()>())
+	{
+		// Writes one row of per-phase costs for each particle count
+		// The output is tab separated so that runs from different releases can be compared with a spreadsheet or diff
+		ostr << "spawn/update/cull/batch, nanoseconds per particle (allocations per frame)" << std::endl;
+		ostr << "particles\tspawn\tupdate\tcull\tbatch\tspawn allocs\tupdate allocs\tcull allocs\tbatch allocs" << std::endl;
+		for (std::size_t count : counts)
+		{
+			PhaseBenchmark result = benchmarkPhases(count, frames, allocations);
+			ostr << result.particles << '\t' << result.spawnNanoseconds << '\t' << result.updateNanoseconds << '\t'
+				 << result.cullNanoseconds << '\t' << result.batchNanoseconds << '\t' << result.spawnAllocations << '\t'
+				 << result.updateAllocations << '\t' << result.cullAllocations << '\t' << result.batchAllocations << std::endl;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,424 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+#include <SFML/Graphics/Color.hpp>
+#include <SFML/Graphics/Vertex.hpp>
+#include <SFML/System/Time.hpp>
+#include <SFML/System/Vector2.hpp>
+
+#include "ParticleCompaction.hpp"
+#include "ParticleKernels.hpp"
+#include "WorkerPool.hpp"
+
+// The ParticleBuffer class stores a set of particles as a structure of arrays instead of as individual objects.
+
+// Every particle attribute (position, velocity, age, lifespan, and color) lives in its own contiguous column, and
+// particle i is made up of the i-th element of each column. The update functions walk those columns linearly, so
+// there is no pointer chasing, no virtual dispatch, and no per-particle allocation.
+
+// Ages and lifespans are stored in seconds so that every numeric column is a plain array of floats. The columns are
+// updated with the vectorized kernels from ParticleKernels.hpp.
+
+// TODO: tests
+
+namespace sfext
+{
+	struct ParticleColumns
+	{
+		// Pointers to the same particle in each column of a ParticleBuffer
+		float *     positionX;
+		float *     positionY;
+		float *     velocityX;
+		float *     velocityY;
+		float *     age;
+		float *     lifespan;
+		sf::Color * color;
+	};
+
+	class ParticleBuffer final
+	{
+	private:
+		std::vector<float>     m_positionX;
+		std::vector<float>     m_positionY;
+		std::vector<float>     m_velocityX;
+		std::vector<float>     m_velocityY;
+		std::vector<float>     m_age;
+		std::vector<float>     m_lifespan;
+		std::vector<sf::Color> m_color;
+		std::vector<float>     m_scratch;
+		std::vector<sf::Color> m_colorScratch;
+		ParticleKernelPath     m_kernels;
+	public:
+		// Constructors
+		ParticleBuffer         () : m_kernels(detectParticleKernelPath())
+		{
+		}
+		explicit ParticleBuffer(std::size_t capacity) : m_kernels(detectParticleKernelPath())
+		{
+			reserve(capacity);
+		}
+		// Destructor
+		~ParticleBuffer()
+		{
+		}
+		// Accessors
+		std::size_t  size       () const
+		{
+			// Returns the number of particles in the buffer
+			return m_age.size();
+		}
+		bool         empty      () const
+		{
+			// Returns true if the buffer does not contain any particles
+			return m_age.empty();
+		}
+		std::size_t  capacity   () const
+		{
+			// Returns the number of particles the buffer can hold before it has to reallocate
+			return m_age.capacity();
+		}
+		sf::Vector2f getPosition(std::size_t index) const
+		{
+			// Returns the current position of a particle
+			return sf::Vector2f(m_positionX[index], m_positionY[index]);
+		}
+		sf::Vector2f getVelocity(std::size_t index) const
+		{
+			// Returns the current velocity of a particle
+			return sf::Vector2f(m_velocityX[index], m_velocityY[index]);
+		}
+		sf::Time     getAge     (std::size_t index) const
+		{
+			// Returns the current age of a particle
+			return sf::seconds(m_age[index]);
+		}
+		sf::Time     getLifespan(std::size_t index) const
+		{
+			// Returns the maximum lifespan of a particle
+			return sf::seconds(m_lifespan[index]);
+		}
+		sf::Color    getColor   (std::size_t index) const
+		{
+			// Returns the color of a particle
+			return m_color[index];
+		}
+		bool         isDead     (std::size_t index) const
+		{
+			// Returns true if the particle is dead, else returns false
+			return m_age[index] > m_lifespan[index];
+		}
+		const float * getAges      () const
+		{
+			// Returns the age column, in seconds, with one entry per particle
+			return m_age.data();
+		}
+		const float * getPositionsY() const
+		{
+			// Returns the column of y coordinates, with one entry per particle
+			return m_positionY.data();
+		}
+		ParticleKernelPath getKernelPath() const
+		{
+			// Returns the kernel path used by the update functions
+			return m_kernels;
+		}
+		// Mutators
+		void setPosition(std::size_t index, const sf::Vector2f & position)
+		{
+			// Overwrite the current position of a particle
+			m_positionX[index] = position.x;
+			m_positionY[index] = position.y;
+		}
+		void setVelocity(std::size_t index, const sf::Vector2f & velocity)
+		{
+			// Overwrite the current velocity of a particle
+			m_velocityX[index] = velocity.x;
+			m_velocityY[index] = velocity.y;
+		}
+		void setAge     (std::size_t index, sf::Time age)
+		{
+			// Overwrite the current age of a particle
+			m_age[index] = age.asSeconds();
+		}
+		void setLifespan(std::size_t index, sf::Time lifespan)
+		{
+			// Overwrite the maximum lifespan of a particle
+			m_lifespan[index] = lifespan.asSeconds();
+		}
+		void setColor   (std::size_t index, const sf::Color & color)
+		{
+			// Overwrite the color of a particle
+			m_color[index] = color;
+		}
+		bool setKernelPath(ParticleKernelPath path)
+		{
+			// Choose which kernel path the update functions use
+			// The fastest supported path is chosen by default; unsupported paths are rejected
+			if (!isParticleKernelPathSupported(path))
+				return false;
+			m_kernels = path;
+			return true;
+		}
+		void reserve    (std::size_t capacity)
+		{
+			// Reserve room for at least capacity particles in every column
+			m_positionX.reserve(capacity);
+			m_positionY.reserve(capacity);
+			m_velocityX.reserve(capacity);
+			m_velocityY.reserve(capacity);
+			m_age.reserve(capacity);
+			m_lifespan.reserve(capacity);
+			m_color.reserve(capacity);
+		}
+		void add        (const sf::Vector2f & position, const sf::Vector2f & velocity, sf::Time lifespan, const sf::Color & color = sf::Color::White)
+		{
+			// Append a new particle to the end of the buffer
+			// The initial age of the particle is 0 seconds
+			m_positionX.push_back(position.x);
+			m_positionY.push_back(position.y);
+			m_velocityX.push_back(velocity.x);
+			m_velocityY.push_back(velocity.y);
+			m_age.push_back(0.f);
+			m_lifespan.push_back(lifespan.asSeconds());
+			m_color.push_back(color);
+		}
+		ParticleColumns append(std::size_t count)
+		{
+			// Grow every column by count particles at once and return pointers to the first new particle in each column
+			// The new particles start with an age of 0 seconds; everything else has to be written by the caller
+			// This lets factories fill a whole batch of particles directly, column by column
+			std::size_t first = size();
+			resize(first + count);
+			ParticleColumns columns = { m_positionX.data() + first, m_positionY.data() + first, m_velocityX.data() + first, m_velocityY.data() + first, m_age.data() + first, m_lifespan.data() + first, m_color.data() + first };
+			return columns;
+		}
+		void reorder    (const std::vector<std::uint32_t> & order)
+		{
+			// Rearrange the particles so that the particle at order[i] ends up at index i
+			// order must be a permutation of [0, size()), such as the one computed by a ParticleSorter
+			// Each column is gathered into a scratch column that then takes its place, so no memory is allocated once
+			// the scratch columns have grown to the size of the buffer
+			gather(m_positionX, m_scratch, order);
+			gather(m_positionY, m_scratch, order);
+			gather(m_velocityX, m_scratch, order);
+			gather(m_velocityY, m_scratch, order);
+			gather(m_age, m_scratch, order);
+			gather(m_lifespan, m_scratch, order);
+			gather(m_color, m_colorScratch, order);
+		}
+		void remove     (std::size_t index)
+		{
+			// Remove a single particle by moving the last particle into its slot
+			// This does not preserve the order of the remaining particles
+			std::size_t last = size() - 1;
+			if (index != last)
+				copy(last, index);
+			resize(last);
+		}
+		void clear      ()
+		{
+			// Remove every particle from the buffer without releasing the reserved memory
+			resize(0);
+		}
+		// Utilities
+		void move               (sf::Time elapsed)
+		{
+			// Update the position of each particle based on its velocity
+			const float seconds = elapsed.asSeconds();
+			addScaled(m_kernels, m_positionX.data(), m_velocityX.data(), seconds, size());
+			addScaled(m_kernels, m_positionY.data(), m_velocityY.data(), seconds, size());
+		}
+		void accelerate         (const sf::Vector2f & direction, sf::Time elapsed)
+		{
+			// Update the velocity of each particle based on a force vector
+			const float seconds = elapsed.asSeconds();
+			addConstant(m_kernels, m_velocityX.data(), direction.x * seconds, size());
+			addConstant(m_kernels, m_velocityY.data(), direction.y * seconds, size());
+		}
+		void age                (sf::Time elapsed)
+		{
+			// Update the age of each particle
+			addConstant(m_kernels, m_age.data(), elapsed.asSeconds(), size());
+		}
+		void deleteDeadParticles(ParticleCompaction compaction = ParticleCompaction::Stable)
+		{
+			// Remove every dead particle in a single pass
+			std::size_t count = size();
+			switch (compaction)
+			{
+			case ParticleCompaction::Unordered:
+				{
+					// Move the last particle into each dead particle's slot
+					std::size_t index = 0;
+					while (index < count)
+					{
+						if (m_age[index] > m_lifespan[index])
+							copy(--count, index);
+						else
+							++index;
+					}
+					break;
+				}
+			default:
+				{
+					// Living particles are shifted down over the dead ones, so their relative order is preserved
+					std::size_t write = 0;
+					for (std::size_t read = 0; read < count; ++read)
+					{
+						if (m_age[read] > m_lifespan[read])
+							continue;
+						if (write != read)
+							copy(read, write);
+						++write;
+					}
+					count = write;
+					break;
+				}
+			}
+			resize(count);
+		}
+		void step               (sf::Time elapsed, const sf::Vector2f & force = sf::Vector2f(), ParticleCompaction compaction = ParticleCompaction::Stable)
+		{
+			// Accelerate, move, and age each particle and remove the dead ones in a single sweep over the columns
+			// The columns are processed in blocks that fit in the cache: each block is integrated with the vectorized
+			// kernels and then compacted while it is still hot
+			const std::size_t blockSize = 1024;
+			const float seconds = elapsed.asSeconds();
+			const float deltaX = force.x * seconds;
+			const float deltaY = force.y * seconds;
+			std::size_t count = size();
+			switch (compaction)
+			{
+			case ParticleCompaction::Unordered:
+				{
+					std::size_t index = 0;
+					while (index < count)
+					{
+						std::size_t blockEnd = std::min(index + blockSize, count);
+						integrate(index, blockEnd - index, seconds, deltaX, deltaY);
+						while (index < blockEnd)
+						{
+							if (m_age[index] > m_lifespan[index])
+							{
+								copy(--count, index);
+								if (count < blockEnd)
+									blockEnd = count; // The replacement came from this block and has already been integrated
+								else
+									integrate(index, 1, seconds, deltaX, deltaY); // The replacement came from a later block
+							}
+							else
+							{
+								++index;
+							}
+						}
+					}
+					break;
+				}
+			default:
+				{
+					std::size_t write = 0;
+					for (std::size_t block = 0; block < count; block += blockSize)
+					{
+						std::size_t blockEnd = std::min(block + blockSize, count);
+						integrate(block, blockEnd - block, seconds, deltaX, deltaY);
+						for (std::size_t read = block; read < blockEnd; ++read)
+						{
+							if (m_age[read] > m_lifespan[read])
+								continue;
+							if (write != read)
+								copy(read, write);
+							++write;
+						}
+					}
+					count = write;
+					break;
+				}
+			}
+			resize(count);
+		}
+		void step               (sf::Time elapsed, const sf::Vector2f & force, WorkerPool & workers, ParticleCompaction compaction = ParticleCompaction::Stable)
+		{
+			// Same as step, but the particles are integrated on the worker threads in fixed-size chunks
+			// Each chunk only touches its own particles, so the results do not depend on the number of threads
+			// Dead particles are removed afterwards on the calling thread
+			const float seconds = elapsed.asSeconds();
+			const float deltaX = force.x * seconds;
+			const float deltaY = force.y * seconds;
+			workers.parallelFor(size(), WorkerChunkSize, [this, seconds, deltaX, deltaY](std::size_t first, std::size_t last)
+			{
+				integrate(first, last - first, seconds, deltaX, deltaY);
+			});
+			deleteDeadParticles(compaction);
+		}
+		void writeVertices      (sf::Vertex * vertices) const
+		{
+			// Write one point vertex per particle into an already sized vertex range
+			writeVertices(vertices, 0, size());
+		}
+		void writeVertices      (sf::Vertex * vertices, std::size_t first, std::size_t last) const
+		{
+			// Write the point vertices of the particles in [first, last) into vertices[first, last)
+			for (std::size_t i = first; i < last; ++i)
+			{
+				vertices[i].position.x = m_positionX[i];
+				vertices[i].position.y = m_positionY[i];
+				vertices[i].color = m_color[i];
+			}
+		}
+		void writeVertices      (sf::Vertex * vertices, WorkerPool & workers) const
+		{
+			// Write one point vertex per particle on the worker threads
+			// Each thread writes a disjoint range of the vertices
+			workers.parallelFor(size(), WorkerChunkSize, [this, vertices](std::size_t first, std::size_t last)
+			{
+				writeVertices(vertices, first, last);
+			});
+		}
+	private:
+		void integrate(std::size_t first, std::size_t count, float seconds, float deltaX, float deltaY)
+		{
+			// Advance the particles in [first, first + count) by one step
+			addConstant(m_kernels, m_velocityX.data() + first, deltaX, count);
+			addConstant(m_kernels, m_velocityY.data() + first, deltaY, count);
+			addScaled(m_kernels, m_positionX.data() + first, m_velocityX.data() + first, seconds, count);
+			addScaled(m_kernels, m_positionY.data() + first, m_velocityY.data() + first, seconds, count);
+			addConstant(m_kernels, m_age.data() + first, seconds, count);
+		}
+		void copy     (std::size_t from, std::size_t to)
+		{
+			// Overwrite one particle with another, column by column
+			m_positionX[to] = m_positionX[from];
+			m_positionY[to] = m_positionY[from];
+			m_velocityX[to] = m_velocityX[from];
+			m_velocityY[to] = m_velocityY[from];
+			m_age[to] = m_age[from];
+			m_lifespan[to] = m_lifespan[from];
+			m_color[to] = m_color[from];
+		}
+		template <typename T>
+		static void gather(std::vector<T> & column, std::vector<T> & scratch, const std::vector<std::uint32_t> & order)
+		{
+			// Permute a single column through a scratch column
+			scratch.reserve(column.capacity()); // Keep the reserved capacity after the swap
+			scratch.resize(order.size());
+			for (std::size_t i = 0; i < order.size(); ++i)
+				scratch[i] = column[order[i]];
+			column.swap(scratch);
+		}
+		void resize   (std::size_t count)
+		{
+			// Shrink or grow every column to the same length
+			m_positionX.resize(count);
+			m_positionY.resize(count);
+			m_velocityX.resize(count);
+			m_velocityY.resize(count);
+			m_age.resize(count);
+			m_lifespan.resize(count);
+			m_color.resize(count);
+		}
+	};
+}
\ No newline at end of file
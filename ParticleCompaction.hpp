@@ -0,0 +1,10 @@
+#pragma once
+
+namespace sfext
+{
+	enum class ParticleCompaction
+	{
+		Stable, // Dead particles are removed and the survivors keep their relative (draw) order
+		Unordered // Dead particles are replaced by particles from the end of the container, which is cheaper but reorders the survivors
+	};
+}
\ No newline at end of file
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <cstddef>
+
+// The particle kernels are the inner loops that ParticleBuffer uses to update its columns of floats.
+
+// Each kernel has a scalar implementation and, on x86 processors, SSE2 and AVX2 implementations. The fastest path
+// that the processor supports is detected at runtime, so a single build runs everywhere. All of the paths perform
+// the same multiplications and additions in the same order, so they produce identical results.
+
+// TODO: tests
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SFEXT_PARTICLE_KERNELS_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(SFEXT_PARTICLE_KERNELS_X86) && (defined(__GNUC__) || defined(__clang__))
+#define SFEXT_TARGET_SSE2 __attribute__((target("sse2")))
+#define SFEXT_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SFEXT_TARGET_SSE2
+#define SFEXT_TARGET_AVX2
+#endif
+
+namespace sfext
+{
+	enum class ParticleKernelPath
+	{
+		Scalar, // Plain loops, available on every processor
+		SSE2, // 4 floats per instruction
+		AVX2 // 8 floats per instruction
+	};
+
+	namespace PKPF // ParticleKernelsPrivateFunctions
+	{
+		void addScaledScalar  (float * destination, const float * source, float scale, std::size_t count)
+		{
+			// destination[i] += source[i] * scale
+			for (std::size_t i = 0; i < count; ++i)
+				destination[i] += source[i] * scale;
+		}
+		void addConstantScalar(float * destination, float value, std::size_t count)
+		{
+			// destination[i] += value
+			for (std::size_t i = 0; i < count; ++i)
+				destination[i] += value;
+		}
+#if defined(SFEXT_PARTICLE_KERNELS_X86)
+		SFEXT_TARGET_SSE2 void addScaledSSE2  (float * destination, const float * source, float scale, std::size_t count)
+		{
+			const __m128 factor = _mm_set1_ps(scale);
+			std::size_t i = 0;
+			for (; i + 4 <= count; i += 4)
+				_mm_storeu_ps(destination + i, _mm_add_ps(_mm_loadu_ps(destination + i), _mm_mul_ps(_mm_loadu_ps(source + i), factor)));
+			addScaledScalar(destination + i, source + i, scale, count - i);
+		}
+		SFEXT_TARGET_SSE2 void addConstantSSE2(float * destination, float value, std::size_t count)
+		{
+			const __m128 constant = _mm_set1_ps(value);
+			std::size_t i = 0;
+			for (; i + 4 <= count; i += 4)
+				_mm_storeu_ps(destination + i, _mm_add_ps(_mm_loadu_ps(destination + i), constant));
+			addConstantScalar(destination + i, value, count - i);
+		}
+		SFEXT_TARGET_AVX2 void addScaledAVX2  (float * destination, const float * source, float scale, std::size_t count)
+		{
+			const __m256 factor = _mm256_set1_ps(scale);
+			std::size_t i = 0;
+			for (; i + 8 <= count; i += 8)
+				_mm256_storeu_ps(destination + i, _mm256_add_ps(_mm256_loadu_ps(destination + i), _mm256_mul_ps(_mm256_loadu_ps(source + i), factor)));
+			addScaledScalar(destination + i, source + i, scale, count - i);
+		}
+		SFEXT_TARGET_AVX2 void addConstantAVX2(float * destination, float value, std::size_t count)
+		{
+			const __m256 constant = _mm256_set1_ps(value);
+			std::size_t i = 0;
+			for (; i + 8 <= count; i += 8)
+				_mm256_storeu_ps(destination + i, _mm256_add_ps(_mm256_loadu_ps(destination + i), constant));
+			addConstantScalar(destination + i, value, count - i);
+		}
+
+		bool cpuSupportsSSE2()
+		{
+#if defined(_M_X64) || defined(__x86_64__)
+			return true; // Every 64 bit x86 processor supports SSE2
+#elif defined(_MSC_VER)
+			int info[4];
+			__cpuid(info, 1);
+			return (info[3] & (1 << 26)) != 0;
+#else
+			__builtin_cpu_init();
+			return __builtin_cpu_supports("sse2") != 0;
+#endif
+		}
+		bool cpuSupportsAVX2()
+		{
+#if defined(_MSC_VER)
+			int info[4];
+			__cpuid(info, 0);
+			if (info[0] < 7)
+				return false;
+			__cpuid(info, 1);
+			bool osxsave = (info[2] & (1 << 27)) != 0;
+			bool avx = (info[2] & (1 << 28)) != 0;
+			if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) // The operating system also has to save the ymm registers
+				return false;
+			__cpuidex(info, 7, 0);
+			return (info[1] & (1 << 5)) != 0;
+#else
+			__builtin_cpu_init();
+			return __builtin_cpu_supports("avx2") != 0;
+#endif
+		}
+#endif
+	}
+
+	bool               isParticleKernelPathSupported(ParticleKernelPath path)
+	{
+		// Returns true if the current processor can run the given kernel path
+		switch (path)
+		{
+#if defined(SFEXT_PARTICLE_KERNELS_X86)
+		case ParticleKernelPath::AVX2:
+			{
+				static const bool supported = PKPF::cpuSupportsAVX2();
+				return supported;
+			}
+		case ParticleKernelPath::SSE2:
+			{
+				static const bool supported = PKPF::cpuSupportsSSE2();
+				return supported;
+			}
+#endif
+		case ParticleKernelPath::Scalar:
+			return true;
+		default:
+			return false;
+		}
+	}
+	ParticleKernelPath detectParticleKernelPath     ()
+	{
+		// Returns the fastest kernel path that the current processor supports
+		if (isParticleKernelPathSupported(ParticleKernelPath::AVX2))
+			return ParticleKernelPath::AVX2;
+		if (isParticleKernelPathSupported(ParticleKernelPath::SSE2))
+			return ParticleKernelPath::SSE2;
+		return ParticleKernelPath::Scalar;
+	}
+
+	void addScaled  (ParticleKernelPath path, float * destination, const float * source, float scale, std::size_t count)
+	{
+		// destination[i] += source[i] * scale for every i in [0, count)
+		// The caller is responsible for only passing paths that are supported
+		switch (path)
+		{
+#if defined(SFEXT_PARTICLE_KERNELS_X86)
+		case ParticleKernelPath::AVX2:
+			PKPF::addScaledAVX2(destination, source, scale, count);
+			break;
+		case ParticleKernelPath::SSE2:
+			PKPF::addScaledSSE2(destination, source, scale, count);
+			break;
+#endif
+		default:
+			PKPF::addScaledScalar(destination, source, scale, count);
+			break;
+		}
+	}
+	void addConstant(ParticleKernelPath path, float * destination, float value, std::size_t count)
+	{
+		// destination[i] += value for every i in [0, count)
+		// The caller is responsible for only passing paths that are supported
+		switch (path)
+		{
+#if defined(SFEXT_PARTICLE_KERNELS_X86)
+		case ParticleKernelPath::AVX2:
+			PKPF::addConstantAVX2(destination, value, count);
+			break;
+		case ParticleKernelPath::SSE2:
+			PKPF::addConstantSSE2(destination, value, count);
+			break;
+#endif
+		default:
+			PKPF::addConstantScalar(destination, value, count);
+			break;
+		}
+	}
+}
\ No newline at end of file
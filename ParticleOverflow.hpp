@@ -0,0 +1,10 @@
+#pragma once
+
+namespace sfext
+{
+	enum class ParticleOverflow
+	{
+		Drop, // New particles that do not fit in the particle budget are not created
+		RecycleOldest // The oldest particles are retired to make room for the new ones
+	};
+}
\ No newline at end of file
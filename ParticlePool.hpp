@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// The ParticlePool class is a fixed-capacity allocator for particles of a single type.
+
+// Memory is carved out of the heap in blocks of particles, and a block is never released until the pool is destroyed.
+// When a particle is destroyed its slot is pushed onto an intrusive free list, and the next particle that is created
+// reuses that slot. Once a pool has grown to its working size, creating and destroying particles never touches the
+// global heap.
+
+// The capacity is a hard budget: create() returns nullptr once that many particles are alive. Objects that were
+// created by a pool must be destroyed by the same pool, and must all be destroyed before the pool itself is.
+
+// TODO: tests
+
+namespace sfext
+{
+	template <typename ParticleType>
+	class ParticlePool final
+	{
+	private:
+		typedef typename std::aligned_storage<sizeof(ParticleType) < sizeof(void *) ? sizeof(void *) : sizeof(ParticleType), alignof(ParticleType)>::type Slot;
+
+		std::vector<std::unique_ptr<Slot[]>> m_blocks;
+		void * m_freeList;
+		std::size_t m_blockSize;
+		std::size_t m_carved; // Slots in the last block that have been handed out at least once
+		std::size_t m_size;
+		std::size_t m_capacity;
+	public:
+		// Constructors
+		explicit ParticlePool(std::size_t capacity = std::numeric_limits<std::size_t>::max(), std::size_t blockSize = 1024) : m_freeList(nullptr), m_blockSize(blockSize ? blockSize : 1), m_carved(0), m_size(0), m_capacity(capacity)
+		{
+		}
+		ParticlePool(const ParticlePool &) = delete;
+		ParticlePool & operator = (const ParticlePool &) = delete;
+		// Destructor
+		~ParticlePool()
+		{
+			// The blocks release their memory automatically
+			// Any particle that is still alive at this point is not destroyed
+		}
+		// Accessors
+		std::size_t size    () const
+		{
+			// Returns the number of particles that are currently alive
+			return m_size;
+		}
+		std::size_t capacity() const
+		{
+			// Returns the maximum number of particles that can be alive at once
+			return m_capacity;
+		}
+		bool        full    () const
+		{
+			// Returns true if no more particles can be created
+			return m_size >= m_capacity;
+		}
+		// Mutators
+		void setCapacity(std::size_t capacity)
+		{
+			// Change the particle budget
+			// Lowering it below size() does not destroy anything, it only prevents new particles from being created
+			m_capacity = capacity;
+		}
+		void reserve    (std::size_t count)
+		{
+			// Allocate enough blocks up front for count particles, so that the first burst does not allocate
+			while (m_blocks.size() * m_blockSize < count)
+				addBlock();
+		}
+		// Utilities
+		template <class ... Args>
+		ParticleType * create (Args && ... args)
+		{
+			// Construct a particle in a free slot
+			// Returns nullptr if the pool is full
+			if (full())
+				return nullptr;
+			void * slot = acquire();
+			ParticleType * particle = new (slot) ParticleType(std::forward<Args>(args)...);
+			++m_size;
+			return particle;
+		}
+		void           destroy(ParticleType * particle)
+		{
+			// Destroy a particle that was created by this pool and recycle its slot
+			// Passing nullptr does nothing
+			if (particle == nullptr)
+				return;
+			particle->~ParticleType();
+			void * slot = static_cast<void *>(particle);
+			*static_cast<void **>(slot) = m_freeList;
+			m_freeList = slot;
+			--m_size;
+		}
+	private:
+		void * acquire()
+		{
+			// Pop a slot off the free list, or carve a new one out of the current block
+			if (m_freeList != nullptr)
+			{
+				void * slot = m_freeList;
+				m_freeList = *static_cast<void **>(slot);
+				return slot;
+			}
+			if (m_blocks.empty() || m_carved == m_blockSize)
+				addBlock();
+			return &m_blocks.back()[m_carved++];
+		}
+		void addBlock()
+		{
+			// Append a new block of slots
+			// Slots of the previous block that were never handed out are moved onto the free list so they are not lost
+			if (!m_blocks.empty())
+			{
+				Slot * previous = m_blocks.back().get();
+				for (std::size_t i = m_carved; i < m_blockSize; ++i)
+				{
+					void * slot = &previous[i];
+					*static_cast<void **>(slot) = m_freeList;
+					m_freeList = slot;
+				}
+			}
+			m_blocks.emplace_back(new Slot[m_blockSize]);
+			m_carved = 0;
+		}
+	};
+}
\ No newline at end of file
@@ -0,0 +1,18 @@
+#pragma once
+
+namespace sfext
+{
+	enum class ParticleSortKey
+	{
+		None, // Particles are drawn in the order they are stored in
+		Age, // Particles are sorted by how long they have been alive
+		Depth, // Particles are sorted by their y coordinate
+		Custom // Particles are sorted by a key function supplied by the owner of the particle system
+	};
+
+	enum class ParticleSortOrder
+	{
+		Ascending, // The particle with the smallest key is drawn first, so the one with the largest key ends up on top
+		Descending // The particle with the largest key is drawn first, so the one with the smallest key ends up on top
+	};
+}
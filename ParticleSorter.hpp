@@ -0,0 +1,171 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "ParticleSortKey.hpp"
+
+// The ParticleSorter class computes the draw order of a set of particles from one float key per particle.
+
+// Keys are mapped to unsigned integers that compare in the same order as the floats, and then sorted with a stable
+// least significant digit radix sort. The result is a permutation: getOrder()[i] is the index of the particle that
+// should be stored (and drawn) at position i.
+
+// Particle systems apply the permutation to their storage, so the next frame starts from the previous order. Input that
+// is already sorted is detected in one pass and nothing is reordered, and input with only a handful of particles out of
+// place is fixed with an insertion sort. That helps keys that rarely change order, such as ages. Keys like depth, where
+// moving particles pass each other every frame, need about as much work as a sort from scratch, so they fall through
+// to the full radix sort. Its passes are skipped when every key has the same digit. getLastMethod tells which case a
+// sort took. All of the scratch memory is kept between calls, so sorting does not allocate once the sorter has grown
+// to the size of the particle system.
+
+// TODO: tests
+
+namespace sfext
+{
+	enum class ParticleSortMethod
+	{
+		None, // The keys were already in order, so nothing was moved
+		Insertion, // A few keys were out of order and were moved into place one at a time
+		Radix // The keys were radix sorted
+	};
+
+	class ParticleSorter final
+	{
+	private:
+		std::vector<std::uint32_t> m_keys;
+		std::vector<std::uint32_t> m_keyScratch;
+		std::vector<std::uint32_t> m_order;
+		std::vector<std::uint32_t> m_orderScratch;
+		ParticleSortMethod m_method;
+	public:
+		// Constructors
+		ParticleSorter() : m_method(ParticleSortMethod::None)
+		{
+		}
+		// Destructor
+		~ParticleSorter()
+		{
+		}
+		// Accessors
+		const std::vector<std::uint32_t> & getOrder        () const
+		{
+			// Returns the permutation computed by the last call to sort
+			// It is empty if the last call found the keys already sorted
+			return m_order;
+		}
+		ParticleSortMethod                 getLastMethod   () const
+		{
+			// Returns how the last call to sort put the keys in order
+			return m_method;
+		}
+		// Utilities
+		bool sort(const float * keys, std::size_t count, ParticleSortOrder order = ParticleSortOrder::Ascending)
+		{
+			// Compute the stable order of count particles by their keys
+			// Returns false if the particles are already in order, in which case getOrder() is empty and nothing has to move
+			m_order.clear();
+			m_method = ParticleSortMethod::None;
+			m_keys.resize(count);
+			const std::uint32_t flip = order == ParticleSortOrder::Descending ? 0xFFFFFFFFu : 0u;
+			std::size_t descents = 0;
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				m_keys[i] = toRadixKey(keys[i]) ^ flip;
+				if (i > 0 && m_keys[i] < m_keys[i - 1])
+					++descents;
+			}
+			if (descents == 0)
+				return false;
+			m_order.resize(count);
+			for (std::size_t i = 0; i < count; ++i)
+				m_order[i] = static_cast<std::uint32_t>(i);
+			// A handful of particles that moved past their neighbours are cheaper to fix one at a time
+			// The insertion sort gives up once it has moved about as many elements as the radix sort would
+			if (descents <= count / 32 && insertionSort(count * 4))
+			{
+				m_method = ParticleSortMethod::Insertion;
+				return true;
+			}
+			radixSort();
+			m_method = ParticleSortMethod::Radix;
+			return true;
+		}
+	private:
+		static std::uint32_t toRadixKey(float key)
+		{
+			// Map a float to an unsigned integer with the same ordering
+			// Negative floats have every bit flipped, and positive floats only have the sign bit flipped
+			std::uint32_t bits;
+			std::memcpy(&bits, &key, sizeof(bits));
+			return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+		}
+		bool insertionSort(std::size_t budget)
+		{
+			// Stable insertion sort of the keys, carrying the order along
+			// Returns false if it ran out of budget. The keys are still a permutation of the input with equal keys in
+			// their original order, so the radix sort can pick up from wherever it stopped
+			std::size_t moves = 0;
+			for (std::size_t i = 1; i < m_keys.size(); ++i)
+			{
+				std::uint32_t key = m_keys[i];
+				std::uint32_t index = m_order[i];
+				std::size_t j = i;
+				while (j > 0 && m_keys[j - 1] > key)
+				{
+					m_keys[j] = m_keys[j - 1];
+					m_order[j] = m_order[j - 1];
+					--j;
+				}
+				m_keys[j] = key;
+				m_order[j] = index;
+				moves += i - j;
+				if (moves > budget)
+					return false;
+			}
+			return true;
+		}
+		void radixSort()
+		{
+			// Four stable passes of 8 bits each, from the least significant byte to the most significant one
+			// All four histograms are built in a single pass over the keys
+			const std::size_t count = m_keys.size();
+			std::size_t histograms[4][256] = {};
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				std::uint32_t key = m_keys[i];
+				++histograms[0][key & 0xFF];
+				++histograms[1][(key >> 8) & 0xFF];
+				++histograms[2][(key >> 16) & 0xFF];
+				++histograms[3][key >> 24];
+			}
+			m_keyScratch.resize(count);
+			m_orderScratch.resize(count);
+			for (unsigned int pass = 0; pass < 4; ++pass)
+			{
+				std::size_t * histogram = histograms[pass];
+				const unsigned int shift = pass * 8;
+				// A pass where every key has the same digit would not move anything
+				if (histogram[(m_keys[0] >> shift) & 0xFF] == count)
+					continue;
+				std::size_t offset = 0;
+				for (unsigned int digit = 0; digit < 256; ++digit)
+				{
+					std::size_t digitCount = histogram[digit];
+					histogram[digit] = offset;
+					offset += digitCount;
+				}
+				for (std::size_t i = 0; i < count; ++i)
+				{
+					std::size_t destination = histogram[(m_keys[i] >> shift) & 0xFF]++;
+					m_keyScratch[destination] = m_keys[i];
+					m_orderScratch[destination] = m_order[i];
+				}
+				m_keys.swap(m_keyScratch);
+				m_order.swap(m_orderScratch);
+			}
+		}
+	};
+}
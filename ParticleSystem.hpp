@@ -1,9 +1,30 @@
 #pragma once
 
 #include "Particle.hpp"
+#include "ParticleCompaction.hpp"
+#include "ParticleOverflow.hpp"
+#include "ParticlePool.hpp"
+#include "ParticleSorter.hpp"
+#include "VertexBatch.hpp"
+#include "WorkerPool.hpp"
 
 #include <SFML/Graphics/Drawable.hpp>
 #include <vector>
+#include <algorithm>
+#include <functional>
+#include <memory>
+
+// Particles are allocated from a ParticlePool owned by the particle system. A Factory that provides
+// std::size_t createBatch(std::size_t n, ParticlePool<ParticleType> &, std::vector<ParticleType *> &) const, which
+// creates up to n particles from the pool, appends them to the vector, and returns how many it created, emits a whole
+// burst in one call and can sample its random numbers in bulk. Otherwise the particles are created one at a time with
+// ParticleType * create(ParticlePool<ParticleType> &) const, or failing that with ParticleType * create() const, whose
+// particle is moved into the pool and then deleted. Dead particles are returned to the pool and their memory is reused
+// by the next particles that are added.
+
+// Particles are drawn in the order they are stored in. An optional sort stage, chosen with setSorting, keeps them
+// ordered by age, depth, or a custom key instead. The sort runs at the end of step and reorders the particle pointers.
+// It is only cheap when hardly any particles change places between frames, otherwise it costs a full radix sort.
 
 // TODO: tests
 
@@ -13,27 +34,98 @@ namespace sfext
 	class ParticleSystem final : public sf::Drawable
 	{
 	private:
+		ParticlePool<ParticleType> m_pool;
 		std::vector<ParticleType *> m_particles;
 		Factory m_factory;
+		ParticleOverflow m_overflow;
+		std::vector<sf::Time> m_ages;
+		ParticleSortKey m_sortKey;
+		ParticleSortOrder m_sortOrder;
+		std::function<float(const ParticleType &)> m_sortFunction;
+		ParticleSorter m_sorter;
+		std::vector<float> m_sortKeys;
+		std::vector<ParticleType *> m_sortedParticles;
+		mutable VertexBatch m_vertices;
+		mutable bool m_batched;
 	public:
 		// Constructors
-		ParticleSystem(const Factory & factory) : m_factory(factory)
+		ParticleSystem(const Factory & factory) : m_factory(factory), m_overflow(ParticleOverflow::Drop), m_sortKey(ParticleSortKey::None), m_sortOrder(ParticleSortOrder::Ascending), m_vertices(ParticleType::getPrimitiveType()), m_batched(false)
+		{
+		}
+		ParticleSystem(const Factory & factory, std::size_t maximumParticles, ParticleOverflow overflow = ParticleOverflow::Drop) : m_pool(maximumParticles), m_factory(factory), m_overflow(overflow), m_sortKey(ParticleSortKey::None), m_sortOrder(ParticleSortOrder::Ascending), m_vertices(ParticleType::getPrimitiveType()), m_batched(false)
 		{
+			// Construct a particle system with a particle budget
+			// All of the memory for the budget is allocated up front
+			m_pool.reserve(maximumParticles);
+			m_particles.reserve(maximumParticles);
 		}
 		// Destructor
 		~ParticleSystem()
 		{
-			// Need to clear the memory for each particle
-			// We know that each particle was allocated with new (because we're the ones that [indirectly] allocate them)
-			for (Particle * particle : m_particles)
-				if (particle != nullptr)
-					delete particle;
-			// Vector destructor will handle the rest
+			// Need to return each particle to the pool before the pool is destroyed
+			// We know that each particle came from the pool (because we're the ones that [indirectly] allocate them)
+			for (ParticleType * particle : m_particles)
+				m_pool.destroy(particle);
+			// Vector and pool destructors will handle the rest
+		}
+		// Accessors
+		std::size_t      size                () const
+		{
+			// Returns the number of particles in the particle system
+			return m_particles.size();
+		}
+		std::size_t      getMaximumParticles () const
+		{
+			// Returns the particle budget
+			return m_pool.capacity();
+		}
+		ParticleOverflow getOverflow         () const
+		{
+			// Returns what happens when particles are added past the particle budget
+			return m_overflow;
+		}
+		ParticleSortKey        getSortKey          () const
+		{
+			// Returns what the particles are sorted by
+			return m_sortKey;
+		}
+		ParticleSortOrder      getSortOrder        () const
+		{
+			// Returns the direction the particles are sorted in
+			return m_sortOrder;
+		}
+		const ParticleSorter & getSorter           () const
+		{
+			// Returns the sorter, which reports how the last sort was done
+			return m_sorter;
+		}
+		// Mutators
+		void setSorting(ParticleSortKey key, ParticleSortOrder order = ParticleSortOrder::Ascending)
+		{
+			// Choose what the particles are sorted by before they are drawn
+			// ParticleSortKey::Custom keeps the key function that was last passed to the other overload
+			m_sortKey = key;
+			m_sortOrder = order;
+		}
+		void setSorting(const std::function<float(const ParticleType &)> & key, ParticleSortOrder order = ParticleSortOrder::Ascending)
+		{
+			// Sort the particles by a custom key, such as the ID of the emitter that created them
+			m_sortKey = ParticleSortKey::Custom;
+			m_sortOrder = order;
+			m_sortFunction = key;
+		}
+		void setMaximumParticles(std::size_t maximumParticles, ParticleOverflow overflow = ParticleOverflow::Drop)
+		{
+			// Change the particle budget and what happens when it is exceeded
+			// Particles that are already alive are kept even if there are more of them than the new budget allows
+			m_pool.setCapacity(maximumParticles);
+			m_overflow = overflow;
 		}
 		// Utilities
 		void move(sf::Time elapsed)
 		{
 			// Update the position of each particle in the particle system
+			m_batched = false;
 			for (Particle * particle : m_particles)
 				if (particle != nullptr)
 					particle->move(elapsed);
@@ -41,6 +133,7 @@ namespace sfext
 		void age(sf::Time elapsed)
 		{
 			// Update the age of each particle in the particle system
+			m_batched = false;
 			for (Particle * particle : m_particles)
 				if (particle != nullptr)
 					particle->age(elapsed);
@@ -49,56 +142,301 @@ namespace sfext
 		{
 			// Update the velocity of each particle in the particle system
 			// Updates based on the current velocity and a force vector
+			m_batched = false;
 			for (Particle * particle : m_particles)
 				if (particle != nullptr)
 					particle->accelerate(direction, elapsed);
 		}
-		void deleteDeadParticles()
+		void deleteDeadParticles(ParticleCompaction compaction = ParticleCompaction::Stable)
 		{
 			// Remove particles that have somehow been deallocated prematurely
 			// or have ages that are greater than the particle's lifespan
-			unsigned int index = 0;
-			unsigned int size = m_particles.size();
-			while (index < size)
+			// Both policies visit each particle once and shrink the vector a single time at the end
+			m_batched = false;
+			std::size_t size = m_particles.size();
+			switch (compaction)
 			{
-				Particle * temp = m_particles.at(index);
-				if (temp != nullptr)
+			case ParticleCompaction::Unordered:
 				{
-					if (temp->isDead())
+					// Fill the hole left by a dead particle with the last particle in the vector
+					std::size_t index = 0;
+					while (index < size)
 					{
-						delete temp;
-						m_particles.erase(m_particles.begin() + index);
-						--size;
+						ParticleType * temp = m_particles[index];
+						if (temp == nullptr || temp->isDead())
+						{
+							m_pool.destroy(temp);
+							m_particles[index] = m_particles[--size];
+						}
+						else
+						{
+							++index;
+						}
 					}
-					else
+					break;
+				}
+			default:
+				{
+					// Shift each surviving particle down over the dead ones
+					std::size_t write = 0;
+					for (std::size_t read = 0; read < size; ++read)
 					{
-						++index;
+						ParticleType * temp = m_particles[read];
+						if (temp == nullptr || temp->isDead())
+							m_pool.destroy(temp);
+						else
+							m_particles[write++] = temp;
 					}
+					size = write;
+					break;
 				}
-				else
+			}
+			m_particles.resize(size);
+		}
+		void step(sf::Time elapsed, const sf::Vector2f & force = sf::Vector2f(), ParticleCompaction compaction = ParticleCompaction::Stable)
+		{
+			// Accelerate, move, and age each particle, then retire it if it has died, all in a single sweep
+			// This is equivalent to calling accelerate, move, age, and deleteDeadParticles in that order,
+			// but each particle is only brought into the cache once per frame
+			// The particles are then sorted if a sort key has been chosen
+			m_batched = false;
+			std::size_t size = m_particles.size();
+			switch (compaction)
+			{
+			case ParticleCompaction::Unordered:
+				{
+					std::size_t index = 0;
+					while (index < size)
+					{
+						ParticleType * temp = m_particles[index];
+						if (temp != nullptr)
+						{
+							temp->accelerate(force, elapsed);
+							temp->move(elapsed);
+							temp->age(elapsed);
+						}
+						if (temp == nullptr || temp->isDead())
+						{
+							// The particle moved into this slot has not been updated yet, so don't advance
+							m_pool.destroy(temp);
+							m_particles[index] = m_particles[--size];
+						}
+						else
+						{
+							++index;
+						}
+					}
+					break;
+				}
+			default:
 				{
-					m_particles.erase(m_particles.begin() + index);
-					--size;
+					std::size_t write = 0;
+					for (std::size_t read = 0; read < size; ++read)
+					{
+						ParticleType * temp = m_particles[read];
+						if (temp != nullptr)
+						{
+							temp->accelerate(force, elapsed);
+							temp->move(elapsed);
+							temp->age(elapsed);
+						}
+						if (temp == nullptr || temp->isDead())
+							m_pool.destroy(temp);
+						else
+							m_particles[write++] = temp;
+					}
+					size = write;
+					break;
 				}
 			}
+			m_particles.resize(size);
+			sort();
+		}
+		void step(sf::Time elapsed, const sf::Vector2f & force, WorkerPool & workers, ParticleCompaction compaction = ParticleCompaction::Stable)
+		{
+			// Same as step, but the particles are accelerated, moved, and aged on the worker threads
+			// Each particle is only touched by one thread, so the results do not depend on the number of threads
+			// Dead particles are then retired on the calling thread, because the pool is not thread safe
+			m_batched = false;
+			workers.parallelFor(m_particles.size(), WorkerChunkSize, [this, elapsed, &force](std::size_t first, std::size_t last)
+			{
+				for (std::size_t i = first; i < last; ++i)
+				{
+					ParticleType * particle = m_particles[i];
+					if (particle != nullptr)
+					{
+						particle->accelerate(force, elapsed);
+						particle->move(elapsed);
+						particle->age(elapsed);
+					}
+				}
+			});
+			deleteDeadParticles(compaction);
+			sort();
+		}
+		void sort()
+		{
+			// Reorder the particles by the current sort key
+			// Does nothing if there is no sort key, or if the particles are already in order
+			if (m_sortKey == ParticleSortKey::None || (m_sortKey == ParticleSortKey::Custom && !m_sortFunction))
+				return;
+			m_sortKeys.resize(m_particles.size());
+			for (std::size_t i = 0; i < m_particles.size(); ++i)
+			{
+				const ParticleType * particle = m_particles[i];
+				if (particle == nullptr)
+					m_sortKeys[i] = 0.f;
+				else if (m_sortKey == ParticleSortKey::Age)
+					m_sortKeys[i] = particle->getAge().asSeconds();
+				else if (m_sortKey == ParticleSortKey::Depth)
+					m_sortKeys[i] = particle->getPosition().y;
+				else
+					m_sortKeys[i] = m_sortFunction(*particle);
+			}
+			if (!m_sorter.sort(m_sortKeys.data(), m_sortKeys.size(), m_sortOrder))
+				return;
+			m_batched = false;
+			const std::vector<std::uint32_t> & order = m_sorter.getOrder();
+			m_sortedParticles.reserve(m_particles.capacity()); // Keep the capacity reserved for the particle budget after the swap
+			m_sortedParticles.resize(order.size());
+			for (std::size_t i = 0; i < order.size(); ++i)
+				m_sortedParticles[i] = m_particles[order[i]];
+			m_particles.swap(m_sortedParticles);
+		}
+		void batch(WorkerPool & workers)
+		{
+			// Write the vertices of every particle into the draw batch on the worker threads
+			// Particle i owns vertices [i * getPointCount(), (i + 1) * getPointCount()), so the threads never overlap
+			// The next call to draw uses these vertices as long as the particles are not changed in the meantime
+			const std::size_t pointCount = ParticleType::getPointCount();
+			m_vertices.setPrimitiveType(ParticleType::getPrimitiveType());
+			sf::Vertex * vertices = m_vertices.resize(m_particles.size() * pointCount);
+			workers.parallelFor(m_particles.size(), WorkerChunkSize, [this, vertices, pointCount](std::size_t first, std::size_t last)
+			{
+				for (std::size_t i = first; i < last; ++i)
+				{
+					if (m_particles[i] != nullptr)
+						m_particles[i]->writeVertices(vertices + i * pointCount, pointCount);
+					else
+						std::fill(vertices + i * pointCount, vertices + (i + 1) * pointCount, sf::Vertex(sf::Vector2f(), sf::Color::Transparent));
+				}
+			});
+			m_batched = true;
 		}
 		void draw(sf::RenderTarget & target, sf::RenderStates states = sf::RenderStates::Default) const
 		{
 			// Draw the particles to the desired RenderTarget
 			// Does not use the particle's draw method
-			// Instead uses the addToBatch method to draw all of the particles with a single call to draw
-			sf::VertexArray vertices(ParticleType::getPrimitiveType(), 0U);
-			for (ParticleType * particle : m_particles)
-				if (particle != nullptr)
-					particle->addToBatch(vertices);
-			target.draw(vertices);
+			// Instead each particle writes its vertices in place into a persistent batch, which is drawn with a single call
+			// If the batch is already up to date (see batch), the vertices are not written again
+			if (!m_batched)
+			{
+				const std::size_t pointCount = ParticleType::getPointCount();
+				m_vertices.setPrimitiveType(ParticleType::getPrimitiveType());
+				sf::Vertex * vertices = m_vertices.resize(m_particles.size() * pointCount);
+				std::size_t written = 0;
+				for (ParticleType * particle : m_particles)
+				{
+					if (particle != nullptr)
+					{
+						particle->writeVertices(vertices + written, pointCount);
+						written += pointCount;
+					}
+				}
+				m_vertices.resize(written);
+				m_batched = true;
+			}
+			target.draw(m_vertices, states);
+		}
+		bool setUseVertexBuffer(bool use)
+		{
+			// Opt in to streaming the particle vertices into a GPU resident sf::VertexBuffer
+			// Returns false if vertex buffers are not available
+			return m_vertices.setUseVertexBuffer(use);
 		}
 		// Factory functions
 		void add(unsigned int n)
 		{
 			// Add n new particles to the particle system
-			for (unsigned int i = 0; i < n; ++i)
-				m_particles.push_back(m_factory.create());
+			// If that would exceed the particle budget, either the extra particles are dropped or the oldest
+			// particles are retired to make room, depending on the overflow policy
+			m_batched = false;
+			// When the budget was lowered below the number of live particles, the excess is retired as well
+			std::size_t needed = m_pool.size() + std::min<std::size_t>(n, m_pool.capacity());
+			if (needed > m_pool.capacity() && m_overflow == ParticleOverflow::RecycleOldest)
+				retireOldest(needed - m_pool.capacity());
+			create(m_factory, n, BatchCreator());
+		}
+	private:
+		// The ways a factory can create particles, from the most preferred to the least
+		struct SingleCreator {};
+		struct PoolCreator : SingleCreator {};
+		struct BatchCreator : PoolCreator {};
+
+		template <typename FactoryType>
+		auto create(FactoryType & factory, std::size_t n, BatchCreator) -> decltype(factory.createBatch(n, m_pool, m_particles), void())
+		{
+			factory.createBatch(n, m_pool, m_particles);
+		}
+		template <typename FactoryType>
+		auto create(FactoryType & factory, std::size_t n, PoolCreator) -> decltype(factory.create(m_pool), void())
+		{
+			for (std::size_t i = 0; i < n; ++i)
+			{
+				ParticleType * particle = factory.create(m_pool);
+				if (particle == nullptr)
+					return;
+				m_particles.push_back(particle);
+			}
+		}
+		template <typename FactoryType>
+		void create(FactoryType & factory, std::size_t n, SingleCreator)
+		{
+			for (std::size_t i = 0; i < n && !m_pool.full(); ++i)
+			{
+				std::unique_ptr<ParticleType> created(factory.create());
+				ParticleType * particle = created ? m_pool.create(std::move(*created)) : nullptr;
+				if (particle != nullptr)
+					m_particles.push_back(particle);
+			}
+		}
+		void retireOldest(std::size_t count)
+		{
+			// Destroy the count oldest particles without changing the order of the others
+			// The ages are copied into a scratch vector that is kept between calls, and the age of the count-th
+			// oldest particle is found with a partial sort
+			m_ages.clear();
+			for (ParticleType * particle : m_particles)
+				if (particle != nullptr)
+					m_ages.push_back(particle->getAge());
+			if (count == 0 || m_ages.empty())
+				return;
+			count = std::min(count, m_ages.size());
+			std::nth_element(m_ages.begin(), m_ages.begin() + (count - 1), m_ages.end(), std::greater<sf::Time>());
+			const sf::Time threshold = m_ages[count - 1];
+			// Particles older than the threshold are always retired, and only as many as needed at the threshold
+			std::size_t ties = count;
+			for (std::size_t i = 0; i < count; ++i)
+				if (m_ages[i] > threshold)
+					--ties;
+			std::size_t write = 0;
+			for (std::size_t read = 0; read < m_particles.size(); ++read)
+			{
+				ParticleType * temp = m_particles[read];
+				if (temp == nullptr)
+					continue;
+				bool retire = temp->getAge() > threshold;
+				if (!retire && ties > 0 && temp->getAge() == threshold)
+				{
+					retire = true;
+					--ties;
+				}
+				if (retire)
+					m_pool.destroy(temp);
+				else
+					m_particles[write++] = temp;
+			}
+			m_particles.resize(write);
 		}
 	};
 }
\ No newline at end of file
@@ -5,6 +5,8 @@
 #include <cmath>
 #include <random>
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
 
 // TODO: tests
 
@@ -23,6 +25,19 @@ namespace sfext
 			std::swap(lower, upper);
 		return std::uniform_real_distribution<double>(lower, upper)(engine);
 	}
+	void         randomReals   (float * output, std::size_t count, float lower = 0.f, float upper = 1.f)
+	{
+		// Fills output with count random real numbers in the range [lower, upper)
+		// Meant for sampling many values at once: the generator produces raw bits and the conversion loop vectorizes
+		static std::mt19937 engine(seed());
+		if (lower > upper)
+			std::swap(lower, upper);
+		for (std::size_t i = 0; i < count; ++i)
+			output[i] = static_cast<float>(static_cast<std::uint32_t>(engine()) >> 8); // 24 random bits fit exactly in a float
+		const float scale = (upper - lower) / 16777216.f;
+		for (std::size_t i = 0; i < count; ++i)
+			output[i] = lower + output[i] * scale;
+	}
 	int          randomInt     (int lower = 0, int upper = 1)
 	{
 		// Returns a random integer in the range [lower, upper]
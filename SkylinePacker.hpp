@@ -0,0 +1,145 @@
+#pragma once
+
+#include <SFML/Graphics/Rect.hpp>
+
+#include <cstddef>
+#include <vector>
+
+// The SkylinePacker class places rectangles into a fixed-size bin without overlapping them.
+
+// The packer only remembers the skyline: the height of the topmost placed rectangle across every column of the bin,
+// stored as a list of horizontal segments. A new rectangle is placed on the skyline wherever its bottom edge ends up
+// lowest (the bottom-left heuristic), and the segments it covers are raised to its top edge. Space that ends up under
+// a rectangle that overhangs a lower segment is lost, which costs a few percent of the bin for typical sprite sheets
+// but keeps packing fast and the state tiny. Rectangles cannot be taken out again; reset starts over with an empty bin.
+
+// TODO: tests
+
+namespace sfext
+{
+	class SkylinePacker final
+	{
+	private:
+		struct Segment
+		{
+			int x;
+			int y;
+			int width;
+		};
+
+		std::vector<Segment> m_skyline;
+		int m_width;
+		int m_height;
+		long long m_usedArea;
+	public:
+		// Constructors
+		SkylinePacker(int width, int height) : m_width(width), m_height(height), m_usedArea(0)
+		{
+			reset();
+		}
+		// Destructor
+		~SkylinePacker()
+		{
+		}
+		// Accessors
+		int   getWidth    () const
+		{
+			return m_width;
+		}
+		int   getHeight   () const
+		{
+			return m_height;
+		}
+		float getOccupancy() const
+		{
+			// Returns the fraction of the bin that is covered by placed rectangles
+			return static_cast<float>(m_usedArea) / (static_cast<float>(m_width) * static_cast<float>(m_height));
+		}
+		// Mutators
+		void reset()
+		{
+			// Forget every placed rectangle
+			m_skyline.assign(1, Segment{ 0, 0, m_width });
+			m_usedArea = 0;
+		}
+		// Utilities
+		bool pack(int width, int height, sf::IntRect & placed)
+		{
+			// Find room for a width by height rectangle and reserve it
+			// Returns false, and leaves the packer unchanged, if the rectangle does not fit anywhere
+			if (width <= 0 || height <= 0 || width > m_width || height > m_height)
+				return false;
+			std::size_t best = m_skyline.size();
+			int bestBottom = 0;
+			int bestY = 0;
+			int bestWidth = 0;
+			for (std::size_t i = 0; i < m_skyline.size(); ++i)
+			{
+				int y;
+				if (!fit(i, width, height, y))
+					continue;
+				// Prefer the lowest bottom edge, then the narrowest segment so that wide gaps stay open
+				if (best == m_skyline.size() || y + height < bestBottom || (y + height == bestBottom && m_skyline[i].width < bestWidth))
+				{
+					best = i;
+					bestBottom = y + height;
+					bestY = y;
+					bestWidth = m_skyline[i].width;
+				}
+			}
+			if (best == m_skyline.size())
+				return false;
+			placed = sf::IntRect(m_skyline[best].x, bestY, width, height);
+			raise(best, placed);
+			m_usedArea += static_cast<long long>(width) * height;
+			return true;
+		}
+	private:
+		bool fit  (std::size_t index, int width, int height, int & y) const
+		{
+			// Find how high a rectangle whose left edge is at segment index has to sit to clear every segment under it
+			int x = m_skyline[index].x;
+			if (x + width > m_width)
+				return false;
+			y = 0;
+			int remaining = width;
+			for (std::size_t i = index; remaining > 0; ++i)
+			{
+				if (m_skyline[i].y > y)
+					y = m_skyline[i].y;
+				if (y + height > m_height)
+					return false;
+				remaining -= m_skyline[i].width;
+			}
+			return true;
+		}
+		void raise(std::size_t index, const sf::IntRect & placed)
+		{
+			// Replace the segments under a placed rectangle with a single segment at its top edge
+			Segment top{ placed.left, placed.top + placed.height, placed.width };
+			int right = placed.left + placed.width;
+			std::size_t last = index;
+			while (last < m_skyline.size() && m_skyline[last].x + m_skyline[last].width <= right)
+				++last;
+			if (last < m_skyline.size() && m_skyline[last].x < right)
+			{
+				// The last segment is only partly covered, so keep the part that sticks out
+				m_skyline[last].width -= right - m_skyline[last].x;
+				m_skyline[last].x = right;
+			}
+			m_skyline.erase(m_skyline.begin() + index, m_skyline.begin() + last);
+			m_skyline.insert(m_skyline.begin() + index, top);
+			// Merge neighbours at the same height so that the skyline stays short
+			if (index + 1 < m_skyline.size() && m_skyline[index + 1].y == top.y)
+			{
+				m_skyline[index].width += m_skyline[index + 1].width;
+				m_skyline.erase(m_skyline.begin() + index + 1);
+			}
+			if (index > 0 && m_skyline[index - 1].y == top.y)
+			{
+				m_skyline[index - 1].width += m_skyline[index].width;
+				m_skyline.erase(m_skyline.begin() + index);
+			}
+		}
+	};
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// A SlotHandle refers to a value in a SlotMap, or to anything else that is tracked by a slot index and a generation,
+// like the entities of an EntityWorld.
+
+namespace sfext
+{
+	struct SlotHandle
+	{
+		std::uint32_t index; // Slot that the handle refers to
+		std::uint32_t generation; // Generation of the slot when the handle was made; 0 is never valid
+
+		SlotHandle() : index(0), generation(0)
+		{
+		}
+		SlotHandle(std::uint32_t slotIndex, std::uint32_t slotGeneration) : index(slotIndex), generation(slotGeneration)
+		{
+		}
+	};
+
+	bool operator == (const SlotHandle & left, const SlotHandle & right)
+	{
+		return left.index == right.index && left.generation == right.generation;
+	}
+
+	bool operator != (const SlotHandle & left, const SlotHandle & right)
+	{
+		return !(left == right);
+	}
+
+	struct SlotHandleHash
+	{
+		std::size_t operator () (const SlotHandle & handle) const
+		{
+			return static_cast<std::size_t>((static_cast<std::uint64_t>(handle.generation) << 32 | handle.index) * 0x9E3779B97F4A7C15ull >> 16);
+		}
+	};
+}
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "SlotHandle.hpp"
+
+// The SlotMap class stores values in a dense array and hands out generational handles to them.
+
+// A handle is a slot index plus the generation of that slot. Looking a value up through its handle is two array
+// accesses, and a handle to a value that has been erased is recognized as stale because the generation of its slot has
+// moved on. The values themselves are kept contiguous and in insertion order, so walking over every value is a linear
+// scan of an array.
+
+// Erasing a value destroys it right away and leaves a hole in the dense array, which takes constant time. The holes
+// are closed, keeping the order of the other values, the next time a position in the dense array is used (by indexOf,
+// handleAt, operator [] or the iterators), so erasing many values costs a single pass over the array. Values have to
+// be default constructible, since a hole holds a default constructed value until then. Looking values up through their
+// handles does not need the holes closed. Closing them changes the array, so after an erase, compact has to be called
+// before values are read by position from several threads at once. Inserting reuses the slot of an erased value, or
+// appends a new one.
+
+// TODO: tests
+
+namespace sfext
+{
+	template <typename T>
+	class SlotMap final
+	{
+	private:
+		struct Slot
+		{
+			std::uint32_t dense; // Index of the value in the dense array, or the next free slot if the slot is free
+			std::uint32_t generation;
+		};
+
+		static const std::uint32_t NoSlot = std::numeric_limits<std::uint32_t>::max();
+
+		// The dense array is mutable so that the holes can be closed on demand by the const accessors
+		mutable std::vector<T> m_values;
+		mutable std::vector<std::uint32_t> m_owners; // Slot of each value in the dense array, NoSlot for a hole
+		mutable std::vector<Slot> m_slots;
+		mutable std::size_t m_holes;
+		std::uint32_t m_freeSlot;
+	public:
+		typedef typename std::vector<T>::iterator iterator;
+		typedef typename std::vector<T>::const_iterator const_iterator;
+
+		// Constructors
+		SlotMap() : m_holes(0), m_freeSlot(NoSlot)
+		{
+		}
+		// Destructor
+		~SlotMap()
+		{
+		}
+		// Accessors
+		std::size_t size    () const
+		{
+			// Returns the number of values
+			return m_values.size() - m_holes;
+		}
+		bool        empty   () const
+		{
+			// Returns true if there are no values
+			return size() == 0;
+		}
+		bool        contains(const SlotHandle & handle) const
+		{
+			// Returns true if the handle refers to a value that has not been erased
+			return handle.index < m_slots.size() && m_slots[handle.index].generation == handle.generation;
+		}
+		std::size_t indexOf (const SlotHandle & handle) const
+		{
+			// Returns the position of a value in the dense array, or size() if the handle is stale
+			compact();
+			return contains(handle) ? m_slots[handle.index].dense : m_values.size();
+		}
+		SlotHandle  handleAt(std::size_t index) const
+		{
+			// Returns the handle of the value at a position in the dense array
+			compact();
+			std::uint32_t slot = m_owners[index];
+			return SlotHandle(slot, m_slots[slot].generation);
+		}
+		T *         get     (const SlotHandle & handle)
+		{
+			// Returns the value that the handle refers to, or nullptr if the handle is stale
+			return contains(handle) ? &m_values[m_slots[handle.index].dense] : nullptr;
+		}
+		const T *   get     (const SlotHandle & handle) const
+		{
+			// Returns the value that the handle refers to, or nullptr if the handle is stale
+			return contains(handle) ? &m_values[m_slots[handle.index].dense] : nullptr;
+		}
+		T &         operator [] (std::size_t index)
+		{
+			// Returns the value at a position in the dense array
+			compact();
+			return m_values[index];
+		}
+		const T &   operator [] (std::size_t index) const
+		{
+			// Returns the value at a position in the dense array
+			compact();
+			return m_values[index];
+		}
+		// Mutators
+		void       reserve(std::size_t count)
+		{
+			// Allocate room for count values up front
+			m_values.reserve(count);
+			m_owners.reserve(count);
+			m_slots.reserve(count);
+		}
+		SlotHandle insert (T value)
+		{
+			// Append a value and return a handle to it
+			std::uint32_t slot = m_freeSlot;
+			if (slot == NoSlot)
+			{
+				slot = static_cast<std::uint32_t>(m_slots.size());
+				m_slots.push_back(Slot{ 0, 1 });
+			}
+			else
+			{
+				m_freeSlot = m_slots[slot].dense;
+			}
+			m_slots[slot].dense = static_cast<std::uint32_t>(m_values.size());
+			m_values.push_back(std::move(value));
+			m_owners.push_back(slot);
+			return SlotHandle(slot, m_slots[slot].generation);
+		}
+		bool       erase  (const SlotHandle & handle)
+		{
+			// Erase the value that the handle refers to, leaving a hole that is closed later
+			// Returns false if the handle is stale
+			if (!contains(handle))
+				return false;
+			std::uint32_t dense = m_slots[handle.index].dense;
+			m_values[dense] = T();
+			m_owners[dense] = NoSlot;
+			++m_holes;
+			release(handle.index);
+			return true;
+		}
+		void       clear  ()
+		{
+			// Erase every value; every handle that was handed out becomes stale
+			for (std::uint32_t slot : m_owners)
+				if (slot != NoSlot)
+					release(slot);
+			m_values.clear();
+			m_owners.clear();
+			m_holes = 0;
+		}
+		void       compact() const
+		{
+			// Close the holes left by erased values, keeping the other values in order
+			if (m_holes == 0)
+				return;
+			std::size_t kept = 0;
+			for (std::size_t i = 0; i < m_values.size(); ++i)
+			{
+				if (m_owners[i] == NoSlot)
+					continue;
+				if (kept != i)
+				{
+					m_values[kept] = std::move(m_values[i]);
+					m_owners[kept] = m_owners[i];
+				}
+				m_slots[m_owners[kept]].dense = static_cast<std::uint32_t>(kept);
+				++kept;
+			}
+			m_values.resize(kept);
+			m_owners.resize(kept);
+			m_holes = 0;
+		}
+		// Iterators
+		iterator       begin()
+		{
+			compact();
+			return m_values.begin();
+		}
+		iterator       end  ()
+		{
+			compact();
+			return m_values.end();
+		}
+		const_iterator begin() const
+		{
+			compact();
+			return m_values.begin();
+		}
+		const_iterator end  () const
+		{
+			compact();
+			return m_values.end();
+		}
+	private:
+		void release(std::uint32_t slot)
+		{
+			// Put a slot on the free list and move it to its next generation
+			if (++m_slots[slot].generation == 0)
+				m_slots[slot].generation = 1;
+			m_slots[slot].dense = m_freeSlot;
+			m_freeSlot = slot;
+		}
+	};
+}
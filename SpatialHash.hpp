@@ -0,0 +1,306 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include <SFML/Graphics/Rect.hpp>
+
+// The SpatialHash class is a broad phase for collision detection: it answers "which objects might overlap this box?"
+// without testing every object.
+
+// Space is divided into a uniform grid of square cells, and each object is listed in every cell that its bounding box
+// touches. Only cells that contain something are stored, in a hash map keyed by the cell coordinates, so the grid is
+// unbounded. A query visits the cells under the query box and tests only the objects listed there.
+
+// Objects are updated incrementally: moving an object only touches the hash map when the set of cells under its
+// bounding box changes, which for most movers is a few times per second at most. The cell size should be around the
+// size of a typical object; much smaller cells make big objects span many cells, and much bigger cells put too many
+// objects in each one. Objects that would span more than MaximumCells cells, such as level boundaries, are kept in a
+// separate list that every query checks, so they never flood the grid.
+
+// TODO: tests
+
+namespace sfext
+{
+	template <typename Key, typename Hash = std::hash<Key>>
+	class SpatialHash final
+	{
+	private:
+		struct Record
+		{
+			Key key;
+			sf::FloatRect bounds;
+			int left, top, right, bottom; // Inclusive range of cells that the bounds touch
+			bool oversized; // Kept in the oversized list instead of in the cells
+			mutable std::uint32_t stamp; // Last query that reported this record, so it is only reported once
+			bool alive;
+		};
+
+		float m_cellSize;
+		std::vector<Record> m_records;
+		std::vector<std::size_t> m_freeRecords;
+		std::unordered_map<Key, std::size_t, Hash> m_indices;
+		std::unordered_map<std::uint64_t, std::vector<std::size_t>> m_cells;
+		std::vector<std::size_t> m_oversized;
+		mutable std::uint32_t m_stamp;
+	public:
+		static const std::size_t MaximumCells = 64; // Objects that touch more cells than this are stored in the oversized list
+
+		// Constructors
+		explicit SpatialHash(float cellSize = 64.f) : m_cellSize(cellSize > 0.f ? cellSize : 64.f), m_stamp(0)
+		{
+		}
+		// Destructor
+		~SpatialHash()
+		{
+		}
+		// Accessors
+		float       getCellSize() const
+		{
+			// Returns the width and height of a cell
+			return m_cellSize;
+		}
+		std::size_t size       () const
+		{
+			// Returns the number of objects in the spatial hash
+			return m_indices.size();
+		}
+		bool        contains   (const Key & key) const
+		{
+			// Returns true if the object is in the spatial hash
+			return m_indices.find(key) != m_indices.end();
+		}
+		// Mutators
+		void setCellSize(float cellSize)
+		{
+			// Change the size of the cells and redistribute every object
+			if (cellSize <= 0.f || cellSize == m_cellSize)
+				return;
+			m_cellSize = cellSize;
+			m_cells.clear();
+			m_oversized.clear();
+			for (std::size_t index = 0; index < m_records.size(); ++index)
+			{
+				if (m_records[index].alive)
+				{
+					setCells(m_records[index], m_records[index].bounds);
+					addToCells(index);
+				}
+			}
+		}
+		void insert     (const Key & key, const sf::FloatRect & bounds)
+		{
+			// Add an object, or move it if it is already in the spatial hash
+			auto found = m_indices.find(key);
+			if (found != m_indices.end())
+			{
+				update(key, bounds);
+				return;
+			}
+			std::size_t index;
+			if (m_freeRecords.empty())
+			{
+				index = m_records.size();
+				m_records.emplace_back();
+			}
+			else
+			{
+				index = m_freeRecords.back();
+				m_freeRecords.pop_back();
+			}
+			Record & record = m_records[index];
+			record.key = key;
+			record.stamp = m_stamp;
+			record.alive = true;
+			setCells(record, bounds);
+			addToCells(index);
+			m_indices[key] = index;
+		}
+		void update     (const Key & key, const sf::FloatRect & bounds)
+		{
+			// Tell the spatial hash that an object has moved or changed size
+			// The cells are only rewritten if the object now touches a different set of cells
+			auto found = m_indices.find(key);
+			if (found == m_indices.end())
+				return;
+			Record & record = m_records[found->second];
+			Record moved = record;
+			setCells(moved, bounds);
+			if (moved.left == record.left && moved.top == record.top && moved.right == record.right && moved.bottom == record.bottom)
+			{
+				record.bounds = bounds;
+				return;
+			}
+			removeFromCells(found->second);
+			record = moved;
+			addToCells(found->second);
+		}
+		void remove     (const Key & key)
+		{
+			// Take an object out of the spatial hash
+			auto found = m_indices.find(key);
+			if (found == m_indices.end())
+				return;
+			removeFromCells(found->second);
+			m_records[found->second].alive = false;
+			m_freeRecords.push_back(found->second);
+			m_indices.erase(found);
+		}
+		void clear      ()
+		{
+			// Remove every object
+			m_records.clear();
+			m_freeRecords.clear();
+			m_indices.clear();
+			m_cells.clear();
+			m_oversized.clear();
+		}
+		// Utilities
+		void query(const sf::FloatRect & bounds, std::vector<Key> & output) const
+		{
+			// Append the key of every object whose bounding box intersects bounds to output
+			// Each object is reported once, no matter how many cells it shares with bounds
+			// The order of the keys is unspecified
+			queryIf(bounds, output, [](const sf::FloatRect & objectBounds, const sf::FloatRect & queryBounds) { return objectBounds.intersects(queryBounds); });
+		}
+		template <class Test>
+		void queryIf(const sf::FloatRect & bounds, std::vector<Key> & output, Test test) const
+		{
+			// Same as query, but test(objectBounds, bounds) decides which of the objects in the cells under bounds match
+			// The test must not match objects that lie entirely outside of the cells under bounds
+			if (++m_stamp == 0)
+			{
+				// The stamp wrapped around, so old stamps could match again
+				for (const Record & record : m_records)
+					record.stamp = 0;
+				m_stamp = 1;
+			}
+			for (std::size_t index : m_oversized)
+				if (test(m_records[index].bounds, bounds))
+					output.push_back(m_records[index].key);
+			int left = cell(bounds.left), top = cell(bounds.top), right = cell(bounds.left + bounds.width), bottom = cell(bounds.top + bounds.height);
+			for (int y = top; y <= bottom; ++y)
+			{
+				for (int x = left; x <= right; ++x)
+				{
+					auto found = m_cells.find(cellKey(x, y));
+					if (found == m_cells.end())
+						continue;
+					for (std::size_t index : found->second)
+					{
+						const Record & record = m_records[index];
+						if (record.stamp == m_stamp)
+							continue;
+						record.stamp = m_stamp;
+						if (test(record.bounds, bounds))
+							output.push_back(record.key);
+					}
+				}
+			}
+		}
+		void query(const sf::FloatRect & bounds, std::vector<Key> & output, std::vector<std::size_t> & scratch) const
+		{
+			// Same as query, but safe to call from several threads at once as long as nothing modifies the spatial hash
+			// Objects that share several cells with bounds are deduplicated in the caller's scratch vector instead of
+			// being stamped; the keys are appended to output in an order that only depends on the contents of the hash
+			scratch.clear();
+			for (std::size_t index : m_oversized)
+				if (m_records[index].bounds.intersects(bounds))
+					scratch.push_back(index);
+			int left = cell(bounds.left), top = cell(bounds.top), right = cell(bounds.left + bounds.width), bottom = cell(bounds.top + bounds.height);
+			for (int y = top; y <= bottom; ++y)
+			{
+				for (int x = left; x <= right; ++x)
+				{
+					auto found = m_cells.find(cellKey(x, y));
+					if (found == m_cells.end())
+						continue;
+					for (std::size_t index : found->second)
+						if (m_records[index].bounds.intersects(bounds))
+							scratch.push_back(index);
+				}
+			}
+			std::sort(scratch.begin(), scratch.end());
+			scratch.erase(std::unique(scratch.begin(), scratch.end()), scratch.end());
+			for (std::size_t index : scratch)
+				output.push_back(m_records[index].key);
+		}
+	private:
+		int cell(float coordinate) const
+		{
+			// Returns the cell coordinate that contains a world coordinate
+			return static_cast<int>(std::floor(coordinate / m_cellSize));
+		}
+		static std::uint64_t cellKey(int x, int y)
+		{
+			// Packs both cell coordinates into a single hash map key
+			return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(x)) << 32) | static_cast<std::uint32_t>(y);
+		}
+		void setCells(Record & record, const sf::FloatRect & bounds)
+		{
+			// Store the bounds of a record and the range of cells they touch
+			record.bounds = bounds;
+			record.left = cell(bounds.left);
+			record.top = cell(bounds.top);
+			record.right = cell(bounds.left + bounds.width);
+			record.bottom = cell(bounds.top + bounds.height);
+			std::size_t columns = static_cast<std::size_t>(static_cast<std::int64_t>(record.right) - record.left + 1);
+			std::size_t rows = static_cast<std::size_t>(static_cast<std::int64_t>(record.bottom) - record.top + 1);
+			record.oversized = columns > MaximumCells || rows > MaximumCells || columns * rows > MaximumCells;
+		}
+		void addToCells(std::size_t index)
+		{
+			// List a record in every cell in its range
+			const Record & record = m_records[index];
+			if (record.oversized)
+			{
+				m_oversized.push_back(index);
+				return;
+			}
+			for (int y = record.top; y <= record.bottom; ++y)
+				for (int x = record.left; x <= record.right; ++x)
+					m_cells[cellKey(x, y)].push_back(index);
+		}
+		void removeFromCells(std::size_t index)
+		{
+			// Remove a record from every cell in its range
+			// Cells that become empty are erased, so that the map does not grow with every cell an object has visited
+			const Record & record = m_records[index];
+			if (record.oversized)
+			{
+				erase(m_oversized, index);
+				return;
+			}
+			for (int y = record.top; y <= record.bottom; ++y)
+			{
+				for (int x = record.left; x <= record.right; ++x)
+				{
+					auto found = m_cells.find(cellKey(x, y));
+					if (found == m_cells.end())
+						continue;
+					erase(found->second, index);
+					if (found->second.empty())
+						m_cells.erase(found);
+				}
+			}
+		}
+		static void erase(std::vector<std::size_t> & indices, std::size_t index)
+		{
+			// Remove one index from a list by moving the last index into its place
+			for (std::size_t i = 0; i < indices.size(); ++i)
+			{
+				if (indices[i] == index)
+				{
+					indices[i] = indices.back();
+					indices.pop_back();
+					return;
+				}
+			}
+		}
+	};
+}
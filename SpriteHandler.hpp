@@ -1,14 +1,26 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
 #include <map>
 #include <string>
+#include <vector>
 
 #include <SFML/Graphics/Sprite.hpp>
 #include <SFML/System/String.hpp>
 #include <SFML/Graphics/RenderTarget.hpp>
 
+#include "Culling.hpp"
 #include "TextureHandler.hpp"
 
+// Sprites of textures that the TextureHandler packed into its atlas point at the atlas page, with their texture rect
+// set to the alias's part of the page. Texture rects passed to the handler are always relative to the alias's own
+// image, and are moved onto the page automatically. Batching a list of aliases merges every alias on the same page
+// into a single draw call. loadAtlas adds every alias of an atlas that was baked ahead of time.
+
+// Textures are shared with every other handler that loaded the same image (see TextureStore), so copying a
+// SpriteHandler, or building one from a TextureHandler, does not upload anything again.
+
 // TODO: tests
 // TODO: documentation
 
@@ -33,7 +45,11 @@ namespace sfext
 		{
 			for (const auto & texture : m_textures)
 			{
-				m_sprites[texture.first] = sf::Sprite(texture.second);
+				m_sprites[texture.first] = sf::Sprite(*texture.second);
+			}
+			for (ConstAtlasRegionIterator region = m_textures.getAtlas().cbegin(); region != m_textures.getAtlas().cend(); ++region)
+			{
+				m_sprites[region->first] = sf::Sprite(m_textures.getTexture(region->first), region->second.rect);
 			}
 		}
 		SpriteHandler         (const SpriteHandler & rhs) : m_textures(rhs.m_textures), m_sprites(rhs.m_sprites)
@@ -58,12 +74,18 @@ namespace sfext
 		// Mutators
 		void setRepeated   (const sf::String & alias, bool repeated)
 		{
+			// The texture is changed in place, so the sprite keeps pointing at it
 			m_textures.setRepeated(alias, repeated);
 		}
 		void setSmooth     (const sf::String & alias, bool smooth)
 		{
 			m_textures.setSmooth(alias, smooth);
 		}
+		void setAtlasMode  (bool atlasMode)
+		{
+			// Pack the textures that are added from now on into the texture handler's atlas
+			m_textures.setAtlasMode(atlasMode);
+		}
 		void setPosition   (const sf::String & alias, float x, float y)
 		{
 			if (hasTexture(alias))
@@ -130,7 +152,7 @@ namespace sfext
 		void setTextureRect(const sf::String & alias, const sf::IntRect & rectangle)
 		{
 			if (hasTexture(alias))
-				m_sprites[alias].setTextureRect(rectangle);
+				m_sprites[alias].setTextureRect(toPage(alias, rectangle));
 			else
 				throw std::invalid_argument("The sprite <" + alias + "> does not exist.");
 		}
@@ -174,7 +196,7 @@ namespace sfext
 		{
 			if (m_textures.addTexture(filePath, alias, area))
 			{
-				m_sprites[alias] = sf::Sprite(m_textures.getTexture(alias));
+				m_sprites[alias] = sf::Sprite(m_textures.getTexture(alias), m_textures.getTextureRect(alias));
 				return true;
 			}
 			return false;
@@ -183,7 +205,7 @@ namespace sfext
 		{
 			if (m_textures.addTexture(filePath, alias, repeated, smooth, area))
 			{
-				m_sprites[alias] = sf::Sprite(m_textures.getTexture(alias));
+				m_sprites[alias] = sf::Sprite(m_textures.getTexture(alias), m_textures.getTextureRect(alias));
 				return true;
 			}
 			return false;
@@ -192,7 +214,7 @@ namespace sfext
 		{
 			if (m_textures.addTexture(image, alias, area))
 			{
-				m_sprites[alias] = sf::Sprite(m_textures.getTexture(alias));
+				m_sprites[alias] = sf::Sprite(m_textures.getTexture(alias), m_textures.getTextureRect(alias));
 				return true;
 			}
 			return false;
@@ -201,11 +223,37 @@ namespace sfext
 		{
 			if (m_textures.addTexture(image, alias, repeated, smooth, area))
 			{
-				m_sprites[alias] = sf::Sprite(m_textures.getTexture(alias));
+				m_sprites[alias] = sf::Sprite(m_textures.getTexture(alias), m_textures.getTextureRect(alias));
+				return true;
+			}
+			return false;
+		}
+		bool addTexture   (const sf::Image & image, std::uint64_t imageHash, const sf::String & alias, const sf::IntRect & area = sf::IntRect())
+		{
+			// Same as above, with the hash of the image already found by TextureStore::hashImage
+			if (m_textures.addTexture(image, imageHash, alias, area))
+			{
+				m_sprites[alias] = sf::Sprite(m_textures.getTexture(alias), m_textures.getTextureRect(alias));
 				return true;
 			}
 			return false;
 		}
+		bool loadAtlas    (const sf::String & manifestPath)
+		{
+			// Load a manifest written by AtlasBaker and create a sprite for every alias in it
+			AtlasManifest manifest;
+			return manifest.loadFromFile(manifestPath) && loadAtlas(manifest);
+		}
+		bool loadAtlas    (const AtlasManifest & manifest)
+		{
+			bool loaded = m_textures.loadAtlas(manifest);
+			for (ConstAtlasManifestIterator entry = manifest.cbegin(); entry != manifest.cend(); ++entry)
+			{
+				if (m_textures.isInAtlas(entry->first))
+					m_sprites[entry->first] = sf::Sprite(m_textures.getTexture(entry->first), m_textures.getTextureRect(entry->first));
+			}
+			return loaded;
+		}
 		bool hasTexture   (const sf::String & alias) const
 		{
 			return m_textures.hasTexture(alias);
@@ -243,7 +291,7 @@ namespace sfext
 			if (hasTexture(alias))
 			{
 				sf::Sprite tempSprite(m_sprites.at(alias));
-				tempSprite.setTextureRect(rectangle);
+				tempSprite.setTextureRect(toPage(alias, rectangle));
 				target.draw(tempSprite, states);
 			}
 			else
@@ -254,7 +302,7 @@ namespace sfext
 			if (hasTexture(alias))
 			{
 				sf::Sprite tempSprite(m_sprites.at(alias));
-				tempSprite.setTextureRect(rectangle);
+				tempSprite.setTextureRect(toPage(alias, rectangle));
 				tempSprite.setPosition(position);
 				target.draw(tempSprite, states);
 			}
@@ -266,14 +314,17 @@ namespace sfext
 			if (hasTexture(alias))
 			{
 				sf::VertexArray vertices(sf::Quads);
+				sf::FloatRect visibleBounds = getVisibleBounds(target, states);
 				sf::FloatRect globalBounds = m_sprites.at(alias).getGlobalBounds();
 				sf::IntRect textureBounds = m_sprites.at(alias).getTextureRect();
 				for (const sf::Vector2f & position : positions)
 				{
-					vertices.append(sf::Vertex(position, sf::Vector2f(0.f, 0.f)));
-					vertices.append(sf::Vertex(position + sf::Vector2f(globalBounds.width, 0.f), sf::Vector2f(static_cast<float>(textureBounds.width), 0.f)));
-					vertices.append(sf::Vertex(position + sf::Vector2f(globalBounds.width, globalBounds.height), sf::Vector2f(static_cast<float>(textureBounds.width), static_cast<float>(textureBounds.height))));
-					vertices.append(sf::Vertex(position + sf::Vector2f(0.f, globalBounds.height), sf::Vector2f(0.f, static_cast<float>(textureBounds.height))));
+					if (!isVisible(visibleBounds, position, sf::Vector2f(globalBounds.width, globalBounds.height)))
+						continue;
+					vertices.append(sf::Vertex(position, sf::Vector2f(static_cast<float>(textureBounds.left), static_cast<float>(textureBounds.top))));
+					vertices.append(sf::Vertex(position + sf::Vector2f(globalBounds.width, 0.f), sf::Vector2f(static_cast<float>(textureBounds.left + textureBounds.width), static_cast<float>(textureBounds.top))));
+					vertices.append(sf::Vertex(position + sf::Vector2f(globalBounds.width, globalBounds.height), sf::Vector2f(static_cast<float>(textureBounds.left + textureBounds.width), static_cast<float>(textureBounds.top + textureBounds.height))));
+					vertices.append(sf::Vertex(position + sf::Vector2f(0.f, globalBounds.height), sf::Vector2f(static_cast<float>(textureBounds.left), static_cast<float>(textureBounds.top + textureBounds.height))));
 				}
 				states.texture = &m_textures.getTexture(alias);
 				target.draw(vertices, states);
@@ -286,12 +337,16 @@ namespace sfext
 			if (hasTexture(alias) && positions.size() == rectangles.size())
 			{
 				sf::VertexArray vertices(sf::Quads);
+				sf::FloatRect visibleBounds = getVisibleBounds(target, states);
 				for (unsigned int i = 0; i < positions.size(); ++i)
 				{
-					vertices.append(sf::Vertex(positions.at(i), sf::Vector2f(static_cast<float>(rectangles.at(i).left), static_cast<float>(rectangles.at(i).top))));
-					vertices.append(sf::Vertex(positions.at(i) + sf::Vector2f(static_cast<float>(rectangles.at(i).width), 0.f), sf::Vector2f(static_cast<float>(rectangles.at(i).left) + static_cast<float>(rectangles.at(i).width), static_cast<float>(rectangles.at(i).top))));
-					vertices.append(sf::Vertex(positions.at(i) + sf::Vector2f(static_cast<float>(rectangles.at(i).width), static_cast<float>(rectangles.at(i).height)), sf::Vector2f(static_cast<float>(rectangles.at(i).left) + static_cast<float>(rectangles.at(i).width), static_cast<float>(rectangles.at(i).top) + static_cast<float>(rectangles.at(i).height))));
-					vertices.append(sf::Vertex(positions.at(i) + sf::Vector2f(0.f, static_cast<float>(rectangles.at(i).height)), sf::Vector2f(static_cast<float>(rectangles.at(i).left), static_cast<float>(rectangles.at(i).top) + static_cast<float>(rectangles.at(i).height))));
+					if (!isVisible(visibleBounds, positions.at(i), sf::Vector2f(static_cast<float>(rectangles.at(i).width), static_cast<float>(rectangles.at(i).height))))
+						continue;
+					sf::IntRect area = toPage(alias, rectangles.at(i));
+					vertices.append(sf::Vertex(positions.at(i), sf::Vector2f(static_cast<float>(area.left), static_cast<float>(area.top))));
+					vertices.append(sf::Vertex(positions.at(i) + sf::Vector2f(static_cast<float>(rectangles.at(i).width), 0.f), sf::Vector2f(static_cast<float>(area.left) + static_cast<float>(rectangles.at(i).width), static_cast<float>(area.top))));
+					vertices.append(sf::Vertex(positions.at(i) + sf::Vector2f(static_cast<float>(rectangles.at(i).width), static_cast<float>(rectangles.at(i).height)), sf::Vector2f(static_cast<float>(area.left) + static_cast<float>(rectangles.at(i).width), static_cast<float>(area.top) + static_cast<float>(rectangles.at(i).height))));
+					vertices.append(sf::Vertex(positions.at(i) + sf::Vector2f(0.f, static_cast<float>(rectangles.at(i).height)), sf::Vector2f(static_cast<float>(area.left), static_cast<float>(area.top) + static_cast<float>(rectangles.at(i).height))));
 				}
 				states.texture = &m_textures.getTexture(alias);
 				target.draw(vertices, states);
@@ -304,12 +359,16 @@ namespace sfext
 			if (hasTexture(alias))
 			{
 				sf::VertexArray vertices(sf::Quads);
+				sf::FloatRect visibleBounds = getVisibleBounds(target, states);
+				sf::IntRect area = toPage(alias, rectangle);
 				for (unsigned int i = 0; i < positions.size(); ++i)
 				{
-					vertices.append(sf::Vertex(positions.at(i), sf::Vector2f(static_cast<float>(rectangle.left), static_cast<float>(rectangle.top))));
-					vertices.append(sf::Vertex(positions.at(i) + sf::Vector2f(static_cast<float>(rectangle.width), 0.f), sf::Vector2f(static_cast<float>(rectangle.left) + static_cast<float>(rectangle.width), static_cast<float>(rectangle.top))));
-					vertices.append(sf::Vertex(positions.at(i) + sf::Vector2f(static_cast<float>(rectangle.width), static_cast<float>(rectangle.height)), sf::Vector2f(static_cast<float>(rectangle.left) + static_cast<float>(rectangle.width), static_cast<float>(rectangle.top) + static_cast<float>(rectangle.height))));
-					vertices.append(sf::Vertex(positions.at(i) + sf::Vector2f(0.f, static_cast<float>(rectangle.height)), sf::Vector2f(static_cast<float>(rectangle.left), static_cast<float>(rectangle.top) + static_cast<float>(rectangle.height))));
+					if (!isVisible(visibleBounds, positions.at(i), sf::Vector2f(static_cast<float>(rectangle.width), static_cast<float>(rectangle.height))))
+						continue;
+					vertices.append(sf::Vertex(positions.at(i), sf::Vector2f(static_cast<float>(area.left), static_cast<float>(area.top))));
+					vertices.append(sf::Vertex(positions.at(i) + sf::Vector2f(static_cast<float>(rectangle.width), 0.f), sf::Vector2f(static_cast<float>(area.left) + static_cast<float>(rectangle.width), static_cast<float>(area.top))));
+					vertices.append(sf::Vertex(positions.at(i) + sf::Vector2f(static_cast<float>(rectangle.width), static_cast<float>(rectangle.height)), sf::Vector2f(static_cast<float>(area.left) + static_cast<float>(rectangle.width), static_cast<float>(area.top) + static_cast<float>(rectangle.height))));
+					vertices.append(sf::Vertex(positions.at(i) + sf::Vector2f(0.f, static_cast<float>(rectangle.height)), sf::Vector2f(static_cast<float>(area.left), static_cast<float>(area.top) + static_cast<float>(rectangle.height))));
 				}
 				states.texture = &m_textures.getTexture(alias);
 				target.draw(vertices, states);
@@ -317,6 +376,43 @@ namespace sfext
 			else
 				throw std::invalid_argument("The sprite <" + alias + "> does not exist.");
 		}
+		void batch        (sf::RenderTarget & target, const std::vector<sf::String> & aliases, const std::vector<sf::Vector2f> & positions, sf::RenderStates states = sf::RenderStates::Default) const
+		{
+			// Draw the sprite of aliases[i] at positions[i] for every i, with one draw call per texture
+			// Aliases that were packed into the same atlas page share a draw call
+			// Sprites with the same texture are drawn in order, and the textures in the order they first appear
+			if (aliases.size() != positions.size())
+				throw std::invalid_argument("Every sprite in a batch needs a position.");
+			std::vector<const sf::Texture *> textures;
+			std::vector<sf::VertexArray> batches;
+			sf::FloatRect visibleBounds = getVisibleBounds(target, states);
+			for (unsigned int i = 0; i < aliases.size(); ++i)
+			{
+				if (!hasTexture(aliases.at(i)))
+					throw std::invalid_argument("The sprite <" + aliases.at(i) + "> does not exist.");
+				const sf::Sprite & sprite = m_sprites.at(aliases.at(i));
+				sf::FloatRect globalBounds = sprite.getGlobalBounds();
+				sf::IntRect textureBounds = sprite.getTextureRect();
+				if (!isVisible(visibleBounds, positions.at(i), sf::Vector2f(globalBounds.width, globalBounds.height)))
+					continue;
+				std::size_t batch = std::find(textures.begin(), textures.end(), sprite.getTexture()) - textures.begin();
+				if (batch == textures.size())
+				{
+					textures.push_back(sprite.getTexture());
+					batches.emplace_back(sf::Quads);
+				}
+				sf::VertexArray & vertices = batches[batch];
+				vertices.append(sf::Vertex(positions.at(i), sf::Vector2f(static_cast<float>(textureBounds.left), static_cast<float>(textureBounds.top))));
+				vertices.append(sf::Vertex(positions.at(i) + sf::Vector2f(globalBounds.width, 0.f), sf::Vector2f(static_cast<float>(textureBounds.left + textureBounds.width), static_cast<float>(textureBounds.top))));
+				vertices.append(sf::Vertex(positions.at(i) + sf::Vector2f(globalBounds.width, globalBounds.height), sf::Vector2f(static_cast<float>(textureBounds.left + textureBounds.width), static_cast<float>(textureBounds.top + textureBounds.height))));
+				vertices.append(sf::Vertex(positions.at(i) + sf::Vector2f(0.f, globalBounds.height), sf::Vector2f(static_cast<float>(textureBounds.left), static_cast<float>(textureBounds.top + textureBounds.height))));
+			}
+			for (std::size_t batch = 0; batch < batches.size(); ++batch)
+			{
+				states.texture = textures[batch];
+				target.draw(batches[batch], states);
+			}
+		}
 		// Iterators
 		SpriteIterator             begin  ()
 		{
@@ -358,5 +454,13 @@ namespace sfext
 		{
 			return m_sprites.find(alias);
 		}
+	private:
+		sf::IntRect toPage(const sf::String & alias, const sf::IntRect & rectangle) const
+		{
+			// Turn a rectangle of an alias's own texture into the matching rectangle of the texture it is drawn from
+			// This only moves it for aliases that were packed into the atlas
+			sf::IntRect textureRect = m_textures.getTextureRect(alias);
+			return sf::IntRect(textureRect.left + rectangle.left, textureRect.top + rectangle.top, rectangle.width, rectangle.height);
+		}
 	};
 }
\ No newline at end of file
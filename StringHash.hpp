@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <SFML/System/String.hpp>
+
+namespace sfext
+{
+	struct StringHash
+	{
+		// Hashes an sf::String so that it can be used as the key of an unordered container
+		// Uses FNV-1a over the UTF-32 code points
+		std::size_t operator () (const sf::String & string) const
+		{
+			const sf::Uint32 * data = string.getData();
+			std::uint64_t hash = 14695981039346656037ull;
+			for (std::size_t i = 0; i < string.getSize(); ++i)
+			{
+				hash ^= data[i];
+				hash *= 1099511628211ull;
+			}
+			return static_cast<std::size_t>(hash);
+		}
+	};
+}
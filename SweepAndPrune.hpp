@@ -0,0 +1,272 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <SFML/Graphics/Rect.hpp>
+
+// The SweepAndPrune class is a broad phase for scenes where most objects move every frame.
+
+// The minimum and maximum of every bounding box are kept in one sorted list of endpoints per axis. Objects only move a
+// little from one frame to the next, so the lists stay almost sorted and an insertion sort puts them back in order in
+// close to linear time. The overlapping pairs are then found by sweeping along whichever axis separates the objects
+// best, keeping a list of the boxes that are open at the current endpoint.
+
+// Typical use, with entities as the keys:
+//     for (Entity * entity : movers)
+//         sweep.update(entity, entity->getBoundingBox());
+//     for (const auto & pair : sweep.findPairs())
+//         pair.first->handleIntersection(*pair.second);
+// EntityHandler keeps one up to date itself when its broad phase is set to BroadPhase::SweepAndPrune.
+
+// TODO: tests
+
+namespace sfext
+{
+	struct SweepAndPruneStats
+	{
+		std::size_t objects; // Objects in the broad phase
+		std::size_t pairs; // Overlapping pairs found
+		std::size_t swaps; // Endpoints moved by the insertion sort, which measures how much the scene changed
+		double milliseconds; // Time taken by findPairs
+	};
+
+	template <typename Key, typename Hash = std::hash<Key>>
+	class SweepAndPrune final
+	{
+	private:
+		struct Box
+		{
+			Key key;
+			sf::FloatRect bounds;
+			bool alive;
+		};
+		struct Endpoint
+		{
+			float value;
+			std::uint32_t box;
+			bool maximum;
+		};
+
+		std::vector<Box> m_boxes;
+		std::vector<std::uint32_t> m_freeBoxes;
+		std::unordered_map<Key, std::uint32_t, Hash> m_indices;
+		std::vector<Endpoint> m_endpoints[2]; // One list per axis, x then y
+		std::vector<std::uint32_t> m_open;
+		std::vector<std::pair<Key, Key>> m_pairs;
+		std::size_t m_inserted; // Endpoints appended since the last sort
+		bool m_removed; // Some endpoints belong to removed boxes
+		SweepAndPruneStats m_stats;
+	public:
+		// Constructors
+		SweepAndPrune() : m_inserted(0), m_removed(false), m_stats()
+		{
+		}
+		// Destructor
+		~SweepAndPrune()
+		{
+		}
+		// Accessors
+		std::size_t                              size    () const
+		{
+			// Returns the number of objects in the broad phase
+			return m_indices.size();
+		}
+		bool                                     contains(const Key & key) const
+		{
+			// Returns true if the object is in the broad phase
+			return m_indices.find(key) != m_indices.end();
+		}
+		const std::vector<std::pair<Key, Key>> & getPairs() const
+		{
+			// Returns the pairs found by the last call to findPairs
+			return m_pairs;
+		}
+		const SweepAndPruneStats &               getStats() const
+		{
+			// Returns the object count, pair count, sorting work, and timing of the last call to findPairs
+			return m_stats;
+		}
+		// Mutators
+		void insert(const Key & key, const sf::FloatRect & bounds)
+		{
+			// Add an object, or move it if it is already in the broad phase
+			auto found = m_indices.find(key);
+			if (found != m_indices.end())
+			{
+				m_boxes[found->second].bounds = bounds;
+				return;
+			}
+			std::uint32_t index;
+			if (m_freeBoxes.empty())
+			{
+				index = static_cast<std::uint32_t>(m_boxes.size());
+				m_boxes.emplace_back();
+			}
+			else
+			{
+				index = m_freeBoxes.back();
+				m_freeBoxes.pop_back();
+			}
+			m_boxes[index].key = key;
+			m_boxes[index].bounds = bounds;
+			m_boxes[index].alive = true;
+			m_indices[key] = index;
+			for (std::vector<Endpoint> & endpoints : m_endpoints)
+			{
+				endpoints.push_back(Endpoint{ 0.f, index, false });
+				endpoints.push_back(Endpoint{ 0.f, index, true });
+			}
+			m_inserted += 2;
+		}
+		void update(const Key & key, const sf::FloatRect & bounds)
+		{
+			// Tell the broad phase that an object has moved or changed size
+			// The endpoints are re-sorted by the next call to findPairs
+			auto found = m_indices.find(key);
+			if (found != m_indices.end())
+				m_boxes[found->second].bounds = bounds;
+		}
+		void remove(const Key & key)
+		{
+			// Take an object out of the broad phase
+			// Its endpoints are dropped by the next call to findPairs, and only then is its slot reused
+			auto found = m_indices.find(key);
+			if (found == m_indices.end())
+				return;
+			m_boxes[found->second].alive = false;
+			m_indices.erase(found);
+			m_removed = true;
+		}
+		void clear ()
+		{
+			// Remove every object
+			m_boxes.clear();
+			m_freeBoxes.clear();
+			m_indices.clear();
+			m_endpoints[0].clear();
+			m_endpoints[1].clear();
+			m_pairs.clear();
+			m_inserted = 0;
+			m_removed = false;
+		}
+		// Utilities
+		const std::vector<std::pair<Key, Key>> & findPairs()
+		{
+			// Bring the endpoint lists up to date and return every pair of objects whose bounding boxes intersect
+			// Each pair is reported once, in sweep order, which only depends on the bounds and the order of insertion
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			m_stats.swaps = 0;
+			if (m_removed)
+				dropRemovedEndpoints();
+			float spread[2];
+			for (unsigned int axis = 0; axis < 2; ++axis)
+				spread[axis] = sortAxis(axis);
+			m_inserted = 0;
+			sweep(spread[1] > spread[0] ? 1 : 0);
+			m_stats.objects = m_indices.size();
+			m_stats.pairs = m_pairs.size();
+			m_stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			return m_pairs;
+		}
+	private:
+		static bool before(const Endpoint & left, const Endpoint & right)
+		{
+			// Endpoints are ordered by value, with minimums first so that a box always opens before it closes, even if it
+			// has no width; boxes that only touch are tested and then rejected by the intersection test
+			return left.value < right.value || (left.value == right.value && !left.maximum && right.maximum);
+		}
+		void dropRemovedEndpoints()
+		{
+			// Remove the endpoints of removed boxes, keeping the others in order, and recycle the boxes
+			for (std::vector<Endpoint> & endpoints : m_endpoints)
+			{
+				endpoints.erase(std::remove_if(endpoints.begin(), endpoints.end(), [this](const Endpoint & endpoint)
+				{
+					return !m_boxes[endpoint.box].alive;
+				}), endpoints.end());
+			}
+			m_freeBoxes.clear();
+			for (std::uint32_t index = 0; index < m_boxes.size(); ++index)
+				if (!m_boxes[index].alive)
+					m_freeBoxes.push_back(index);
+			m_removed = false;
+		}
+		float sortAxis(unsigned int axis)
+		{
+			// Refresh the endpoint values of one axis and sort them
+			// Returns the variance of the box centers along the axis, which is used to pick the axis to sweep along
+			std::vector<Endpoint> & endpoints = m_endpoints[axis];
+			double sum = 0.0;
+			double squares = 0.0;
+			for (Endpoint & endpoint : endpoints)
+			{
+				const sf::FloatRect & bounds = m_boxes[endpoint.box].bounds;
+				float minimum = axis == 0 ? bounds.left : bounds.top;
+				float length = axis == 0 ? bounds.width : bounds.height;
+				if (length < 0.f)
+				{
+					// Rectangles with a negative size extend to the left of or above their position
+					minimum += length;
+					length = -length;
+				}
+				endpoint.value = endpoint.maximum ? minimum + length : minimum;
+				if (!endpoint.maximum)
+				{
+					double center = minimum + length * .5;
+					sum += center;
+					squares += center * center;
+				}
+			}
+			if (m_inserted > 64 && m_inserted * 8 > endpoints.size())
+			{
+				// Too many new endpoints for an insertion sort to be cheap
+				std::stable_sort(endpoints.begin(), endpoints.end(), before);
+			}
+			else
+			{
+				for (std::size_t i = 1; i < endpoints.size(); ++i)
+				{
+					Endpoint endpoint = endpoints[i];
+					std::size_t j = i;
+					while (j > 0 && before(endpoint, endpoints[j - 1]))
+					{
+						endpoints[j] = endpoints[j - 1];
+						--j;
+					}
+					endpoints[j] = endpoint;
+					m_stats.swaps += i - j;
+				}
+			}
+			double count = static_cast<double>(endpoints.size() / 2);
+			return count > 0.0 ? static_cast<float>(squares / count - (sum / count) * (sum / count)) : 0.f;
+		}
+		void sweep(unsigned int axis)
+		{
+			// Walk the endpoints of one axis in order, testing each box that opens against the boxes that are still open
+			m_pairs.clear();
+			m_open.clear();
+			for (const Endpoint & endpoint : m_endpoints[axis])
+			{
+				if (endpoint.maximum)
+				{
+					auto open = std::find(m_open.begin(), m_open.end(), endpoint.box);
+					*open = m_open.back();
+					m_open.pop_back();
+					continue;
+				}
+				const Box & box = m_boxes[endpoint.box];
+				for (std::uint32_t other : m_open)
+					if (m_boxes[other].bounds.intersects(box.bounds))
+						m_pairs.emplace_back(m_boxes[other].key, box.key);
+				m_open.push_back(endpoint.box);
+			}
+		}
+	};
+}
@@ -0,0 +1,314 @@
+// Headless behavioural tests
+// Usage: Tests
+// Checks the particle storage, pooling and sorting, SlotMap handles, Collidable::sweep, and the texture store and cache
+// Prints every check that fails and returns 1 if there were any, so it can be run after each build
+// The texture checks write a few small images to the working directory and remove them afterwards; like any
+// sf::Texture, they need an OpenGL context to be available
+// Requires C++17, like the other executables
+
+#include "Collidable.hpp"
+#include "ParticleBuffer.hpp"
+#include "ParticlePool.hpp"
+#include "ParticleSorter.hpp"
+#include "SlotMap.hpp"
+#include "TextureCache.hpp"
+#include "TextureStore.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	std::size_t failures = 0;
+
+	void check(bool passed, const std::string & description)
+	{
+		// Report a check that did not pass
+		if (passed)
+			return;
+		std::cerr << "FAILED: " << description << std::endl;
+		++failures;
+	}
+
+	bool isClose(const sf::Vector2f & left, const sf::Vector2f & right)
+	{
+		// Returns true if two vectors are equal up to rounding, which depends on the kernel path and the compiler
+		return std::abs(left.x - right.x) <= 1e-4f * std::max(1.f, std::abs(right.x)) && std::abs(left.y - right.y) <= 1e-4f * std::max(1.f, std::abs(right.y));
+	}
+
+	void fillBuffer(sfext::ParticleBuffer & buffer, std::size_t count)
+	{
+		// Add count particles, every other one of which dies within a second
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			float x = static_cast<float>(i);
+			buffer.add(sf::Vector2f(x, -x), sf::Vector2f(1.f, 2.f + x * 0.01f), sf::seconds(i % 2 ? 3.f : 1.f), sf::Color(static_cast<sf::Uint8>(i), 0, 0));
+		}
+	}
+
+	void testParticleBuffer()
+	{
+		// Stable compaction keeps the survivors in order, unordered compaction keeps the same survivors
+		{
+			sfext::ParticleBuffer buffer(8);
+			fillBuffer(buffer, 8);
+			buffer.step(sf::seconds(2.f));
+			check(buffer.size() == 4, "ParticleBuffer::step removes the dead particles");
+			for (std::size_t i = 0; i < buffer.size(); ++i)
+			{
+				float x = static_cast<float>(2 * i + 1);
+				check(isClose(buffer.getPosition(i), sf::Vector2f(x + 2.f, -x + (2.f + x * 0.01f) * 2.f)), "ParticleBuffer::step moves the survivors");
+				check(buffer.getColor(i).r == 2 * i + 1, "Stable compaction keeps the survivors in order");
+				check(buffer.getAge(i) == sf::seconds(2.f), "ParticleBuffer::step ages the survivors");
+			}
+		}
+		{
+			sfext::ParticleBuffer buffer(8);
+			fillBuffer(buffer, 8);
+			buffer.step(sf::seconds(2.f), sf::Vector2f(), sfext::ParticleCompaction::Unordered);
+			check(buffer.size() == 4, "Unordered compaction removes the dead particles");
+			unsigned int survivors = 0;
+			for (std::size_t i = 0; i < buffer.size(); ++i)
+				survivors |= 1u << buffer.getColor(i).r;
+			check(survivors == 0xAAu, "Unordered compaction keeps every survivor");
+		}
+		// step gives the same result as the separate passes, on every kernel path and across several blocks
+		const std::size_t count = 3001;
+		const sf::Vector2f force(0.5f, 9.81f);
+		sfext::ParticleBuffer expected(count);
+		expected.setKernelPath(sfext::ParticleKernelPath::Scalar);
+		fillBuffer(expected, count);
+		expected.accelerate(force, sf::seconds(1.5f));
+		expected.move(sf::seconds(1.5f));
+		expected.age(sf::seconds(1.5f));
+		expected.deleteDeadParticles();
+		for (sfext::ParticleKernelPath path : { sfext::ParticleKernelPath::Scalar, sfext::ParticleKernelPath::SSE2, sfext::ParticleKernelPath::AVX2 })
+		{
+			sfext::ParticleBuffer buffer(count);
+			if (!buffer.setKernelPath(path))
+				continue;
+			fillBuffer(buffer, count);
+			buffer.step(sf::seconds(1.5f), force);
+			const std::string name = "ParticleBuffer::step on kernel path " + std::to_string(static_cast<int>(path));
+			check(buffer.size() == expected.size(), name + " keeps the same particles as the separate passes");
+			bool same = buffer.size() == expected.size();
+			for (std::size_t i = 0; same && i < buffer.size(); ++i)
+				same = isClose(buffer.getPosition(i), expected.getPosition(i)) && isClose(buffer.getVelocity(i), expected.getVelocity(i)) && buffer.getAge(i) == expected.getAge(i);
+			check(same, name + " matches the separate passes");
+		}
+	}
+
+	struct PooledParticle
+	{
+		int value;
+
+		explicit PooledParticle(int initialValue) : value(initialValue)
+		{
+		}
+	};
+
+	void testParticlePool()
+	{
+		// Destroyed slots are handed out again, and the capacity is a hard limit
+		sfext::ParticlePool<PooledParticle> pool(3, 2);
+		PooledParticle * first = pool.create(1);
+		PooledParticle * second = pool.create(2);
+		PooledParticle * third = pool.create(3);
+		check(first != nullptr && second != nullptr && third != nullptr, "ParticlePool::create constructs particles");
+		check(second->value == 2, "ParticlePool::create forwards its arguments");
+		check(pool.full() && pool.create(4) == nullptr, "ParticlePool::create returns nullptr once the pool is full");
+		pool.destroy(second);
+		check(pool.size() == 2, "ParticlePool::destroy frees a slot");
+		PooledParticle * reused = pool.create(5);
+		check(reused == second && reused->value == 5, "ParticlePool::create reuses the slot that was destroyed last");
+		pool.destroy(first);
+		pool.destroy(third);
+		pool.destroy(reused);
+		pool.destroy(nullptr);
+		check(pool.size() == 0, "ParticlePool::destroy ignores nullptr");
+		std::vector<PooledParticle *> particles;
+		for (int i = 0; i < 3; ++i)
+			particles.push_back(pool.create(i));
+		bool recycled = true;
+		for (PooledParticle * particle : particles)
+			recycled = recycled && (particle == first || particle == third || particle == reused);
+		check(recycled, "ParticlePool reuses its slots instead of carving out new ones");
+		for (PooledParticle * particle : particles)
+			pool.destroy(particle);
+	}
+
+	bool isSortedBy(const std::vector<float> & keys, const std::vector<std::uint32_t> & order, bool descending)
+	{
+		// Returns true if order is a stable sort of the keys
+		std::vector<bool> seen(keys.size(), false);
+		for (std::size_t i = 0; i < order.size(); ++i)
+		{
+			if (order[i] >= keys.size() || seen[order[i]])
+				return false;
+			seen[order[i]] = true;
+			if (i == 0)
+				continue;
+			float previous = keys[order[i - 1]];
+			float current = keys[order[i]];
+			if (descending ? previous < current : current < previous)
+				return false;
+			if (previous == current && order[i] < order[i - 1])
+				return false;
+		}
+		return order.size() == keys.size();
+	}
+
+	void testParticleSorter()
+	{
+		// Random keys with duplicates and both signs are radix sorted, stably, in either direction
+		std::mt19937 generator(12345);
+		std::uniform_int_distribution<int> distribution(-500, 500);
+		std::vector<float> keys(4096);
+		for (float & key : keys)
+			key = static_cast<float>(distribution(generator)) * 0.25f;
+		sfext::ParticleSorter sorter;
+		check(sorter.sort(keys.data(), keys.size()), "ParticleSorter::sort reports that shuffled keys need sorting");
+		check(sorter.getLastMethod() == sfext::ParticleSortMethod::Radix, "Shuffled keys are radix sorted");
+		check(isSortedBy(keys, sorter.getOrder(), false), "The radix sort puts the keys in stable ascending order");
+		sorter.sort(keys.data(), keys.size(), sfext::ParticleSortOrder::Descending);
+		check(isSortedBy(keys, sorter.getOrder(), true), "The radix sort puts the keys in stable descending order");
+		// Sorted keys are left alone, and a few keys out of place are moved one at a time
+		std::vector<float> sorted(keys.size());
+		for (std::size_t i = 0; i < sorted.size(); ++i)
+			sorted[i] = static_cast<float>(i);
+		check(!sorter.sort(sorted.data(), sorted.size()) && sorter.getOrder().empty(), "Keys that are already sorted are not reordered");
+		check(sorter.getLastMethod() == sfext::ParticleSortMethod::None, "Keys that are already sorted take no sort");
+		sorted[100] = 2000.5f;
+		sorted[3000] = -1.f;
+		sorter.sort(sorted.data(), sorted.size());
+		check(sorter.getLastMethod() == sfext::ParticleSortMethod::Insertion, "A few keys out of place are insertion sorted");
+		check(isSortedBy(sorted, sorter.getOrder(), false), "The insertion sort puts the keys in stable ascending order");
+	}
+
+	void testSlotMap()
+	{
+		// Handles to erased values go stale, even once their slot has been reused
+		sfext::SlotMap<int> values;
+		sfext::SlotHandle first = values.insert(1);
+		sfext::SlotHandle second = values.insert(2);
+		sfext::SlotHandle third = values.insert(3);
+		check(values.erase(second), "SlotMap::erase removes a value");
+		check(!values.contains(second) && values.get(second) == nullptr, "A handle to an erased value is stale");
+		check(!values.erase(second), "A stale handle cannot erase anything");
+		sfext::SlotHandle fourth = values.insert(4);
+		check(fourth.index == second.index && fourth != second, "A reused slot gets a new generation");
+		check(!values.contains(second) && values.get(fourth) != nullptr && *values.get(fourth) == 4, "A stale handle does not refer to the value in its reused slot");
+		check(values.size() == 3 && values.indexOf(first) == 0 && values.indexOf(third) == 1 && values.indexOf(fourth) == 2, "SlotMap keeps the values in insertion order");
+		std::vector<int> iterated(values.begin(), values.end());
+		check(iterated == std::vector<int>({ 1, 3, 4 }), "SlotMap iterates over the values in order");
+		values.clear();
+		check(values.empty() && !values.contains(first) && !values.contains(fourth), "SlotMap::clear makes every handle stale");
+	}
+
+	void testCollidableSweep()
+	{
+		// Moving boxes stop at the face that they hit first
+		sfext::Collidable box(0.f, 0.f, 10.f, 10.f);
+		float time = -1.f;
+		sf::Vector2f normal;
+		check(box.sweep(sf::Vector2f(20.f, 0.f), sfext::Collidable(15.f, 0.f, 5.f, 10.f), time, normal) && time == 0.25f && normal == sf::Vector2f(-1.f, 0.f), "Collidable::sweep finds the left face of a wall");
+		check(box.sweep(sf::Vector2f(0.f, -40.f), sfext::Collidable(0.f, -30.f, 10.f, 10.f), time, normal) && time == 0.5f && normal == sf::Vector2f(0.f, 1.f), "Collidable::sweep finds the bottom face of a ceiling");
+		check(box.sweep(sf::Vector2f(20.f, 20.f), sfext::Collidable(15.f, 12.f, 10.f, 10.f), time, normal) && time == 0.25f && normal == sf::Vector2f(-1.f, 0.f), "Collidable::sweep uses the axis that is entered last");
+		check(box.sweep(sf::Vector2f(100.f, 0.f), sfext::Collidable(50.f, 0.f, 1.f, 10.f), time) && time == 0.4f, "Collidable::sweep does not tunnel through thin walls");
+		check(!box.sweep(sf::Vector2f(2.f, 0.f), sfext::Collidable(15.f, 0.f, 5.f, 10.f), time), "Collidable::sweep misses walls out of reach");
+		check(!box.sweep(sf::Vector2f(20.f, 0.f), sfext::Collidable(15.f, 20.f, 5.f, 10.f), time), "Collidable::sweep misses walls off the path");
+		check(!box.sweep(sf::Vector2f(-20.f, 0.f), sfext::Collidable(15.f, 0.f, 5.f, 10.f), time), "Collidable::sweep misses walls behind the box");
+		check(box.sweep(sf::Vector2f(20.f, 0.f), sfext::Collidable(5.f, 5.f, 10.f, 10.f), time, normal) && time == 0.f && normal == sf::Vector2f(0.f, 0.f), "Collidable::sweep reports overlapping boxes at time 0");
+	}
+
+	sf::Image makeImage(unsigned int size, const sf::Color & color)
+	{
+		// Returns a square image of a single color
+		sf::Image image;
+		image.create(size, size, color);
+		return image;
+	}
+
+	void testTextureStore()
+	{
+		// Identical pixels share one texture, different pixels or flags do not
+		sfext::TextureStore store;
+		sf::Image red = makeImage(4, sf::Color(255, 0, 0));
+		sf::Image blue = makeImage(4, sf::Color(0, 0, 255));
+		std::shared_ptr<sf::Texture> first = store.load(red);
+		std::shared_ptr<sf::Texture> second = store.load(red);
+		check(first && first == second, "TextureStore shares the texture of identical images");
+		check(store.getLoadCount() == 1 && store.getReuseCount() == 1 && store.getTextureCount() == 1, "TextureStore uploads identical images once");
+		check(store.load(blue) != first, "TextureStore does not share textures between different images");
+		check(store.load(red, sfext::TextureStore::hashImage(blue)) != first, "TextureStore compares the pixels when two hashes are equal");
+		std::shared_ptr<sf::Texture> smooth = store.load(red, sf::IntRect(), true, false);
+		check(smooth != first && smooth->isSmooth(), "TextureStore does not share textures with different flags");
+		check(store.load(red, sf::IntRect(0, 0, 2, 2)) != first, "TextureStore does not share textures of different areas");
+		// Files are shared with the images that they decode to
+		const std::string path = "sfext_test_store.png";
+		check(red.saveToFile(path), "The test image can be written");
+		std::shared_ptr<sf::Texture> fromFile = store.load(path);
+		check(fromFile == first && store.load(path) == first, "TextureStore shares the texture of a file with the same image");
+		std::remove(path.c_str());
+		// Flags are changed in place, and released textures leave the store
+		check(store.setFlags(*first, false, true) && first->isRepeated() && store.load(red, sf::IntRect(), false, true) == first, "TextureStore::setFlags changes a shared texture in place");
+		check(!store.setFlags(sf::Texture(), true, true), "TextureStore::setFlags rejects textures from elsewhere");
+		first.reset();
+		second.reset();
+		fromFile.reset();
+		smooth.reset();
+		check(store.getTextureCount() == 0, "TextureStore forgets textures that are no longer used");
+	}
+
+	void testTextureCache()
+	{
+		// Unreferenced textures are evicted in least recently used order once the cache is over budget
+		const unsigned int size = 16;
+		const std::vector<std::string> paths = { "sfext_test_cache_a.png", "sfext_test_cache_b.png", "sfext_test_cache_c.png" };
+		for (const std::string & path : paths)
+			check(makeImage(size, sf::Color(0, 255, 0)).saveToFile(path), "The test image can be written");
+		sfext::TextureCache cache(2 * size * size * 4);
+		check(cache.addTexture(paths[0], "a") && cache.addTexture(paths[1], "b"), "TextureCache::addTexture loads textures");
+		check(cache.isResident("a") && cache.isResident("b") && cache.getStats().residentBytes == 2 * size * size * 4, "Textures within the budget stay resident");
+		cache.addTexture(paths[2], "c");
+		check(!cache.isResident("a") && cache.isResident("b") && cache.isResident("c"), "The least recently used texture is evicted");
+		check(cache.getStats().evictions == 1, "TextureCache counts evictions");
+		check(cache.getTexture("a").getSize() == sf::Vector2u(size, size), "An evicted texture is loaded again when it is accessed");
+		check(cache.getStats().misses == 1 && !cache.isResident("b"), "Loading an evicted texture evicts the next least recently used one");
+		{
+			sfext::TextureCache::Reference reference = cache.acquire("c");
+			cache.getTexture("b");
+			check(cache.isResident("c") && !cache.isResident("a"), "Referenced textures are never evicted");
+			check(!cache.removeTexture("c"), "Referenced textures cannot be removed");
+		}
+		cache.evictUnused();
+		check(cache.getStats().residentCount == 0 && cache.getStats().residentBytes == 0, "TextureCache::evictUnused evicts every unreferenced texture");
+		for (const std::string & path : paths)
+			std::remove(path.c_str());
+	}
+}
+
+int main()
+{
+	testParticleBuffer();
+	testParticlePool();
+	testParticleSorter();
+	testSlotMap();
+	testCollidableSweep();
+	testTextureStore();
+	testTextureCache();
+	if (failures != 0)
+	{
+		std::cerr << failures << " checks failed" << std::endl;
+		return 1;
+	}
+	std::cout << "All checks passed" << std::endl;
+	return 0;
+}
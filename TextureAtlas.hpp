@@ -0,0 +1,245 @@
+#pragma once
+
+#include <SFML/Graphics/Image.hpp>
+#include <SFML/Graphics/Rect.hpp>
+#include <SFML/Graphics/Texture.hpp>
+#include <SFML/System/String.hpp>
+
+#include "SkylinePacker.hpp"
+#include "TextureStore.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <vector>
+
+// The TextureAtlas class packs many small images into a few large textures, called pages.
+
+// Each image is placed on the first page that has room for it by a SkylinePacker, and a new page is created when none
+// does. The atlas then hands back the page and the rectangle that an alias ended up in. Everything that is drawn from
+// the same page can share a single vertex array and a single texture bind, no matter which aliases it came from.
+
+// Images are separated by transparent padding (a pixel by default), so that smoothing does not bleed neighbours into
+// each other. Space is never reclaimed: removing or replacing an alias leaves a hole in its page until the atlas is
+// cleared. Repeated textures cannot live in an atlas, since repeating a page would repeat all of it.
+
+// Pages are heap allocated, so the textures (and sprites pointing at them) stay where they are as pages are added.
+// Copies of an atlas share their pages instead of copying them. A page that is shared is never packed into again, so
+// the copies can add images independently, each to pages of its own. Smoothing changes a page in place, so it applies
+// to every atlas that shares the page.
+
+// Pages that were packed ahead of time (see AtlasManifest) can be added whole with addPage and their aliases with
+// addRegion. Nothing else is packed into such a page, so it always reports an occupancy of 1. Such pages usually come
+// from the TextureStore, so every atlas that loads the same baked page shares one texture.
+
+// TODO: tests
+
+namespace sfext
+{
+	struct AtlasRegion
+	{
+		std::size_t page; // Index of the page that the image was packed into
+		sf::IntRect rect; // Pixels of the page that the image covers
+	};
+
+	typedef std::map<sf::String, AtlasRegion>::const_iterator ConstAtlasRegionIterator;
+
+	class TextureAtlas final
+	{
+	private:
+		std::vector<std::shared_ptr<sf::Texture>> m_pages;
+		std::vector<SkylinePacker> m_packers;
+		std::map<sf::String, AtlasRegion> m_regions;
+		unsigned int m_pageSize;
+		unsigned int m_padding;
+		bool m_smooth;
+	public:
+		// Constructors
+		explicit TextureAtlas(unsigned int pageSize = 2048, unsigned int padding = 1) : m_pageSize(pageSize), m_padding(padding), m_smooth(false)
+		{
+		}
+		TextureAtlas(const TextureAtlas & rhs) : m_pages(rhs.m_pages), m_packers(rhs.m_packers), m_regions(rhs.m_regions), m_pageSize(rhs.m_pageSize), m_padding(rhs.m_padding), m_smooth(rhs.m_smooth)
+		{
+		}
+		TextureAtlas & operator = (TextureAtlas rhs)
+		{
+			std::swap(m_pages, rhs.m_pages);
+			std::swap(m_packers, rhs.m_packers);
+			std::swap(m_regions, rhs.m_regions);
+			std::swap(m_pageSize, rhs.m_pageSize);
+			std::swap(m_padding, rhs.m_padding);
+			std::swap(m_smooth, rhs.m_smooth);
+			return *this;
+		}
+		// Destructor
+		~TextureAtlas()
+		{
+		}
+		// Accessors
+		unsigned int        getPageSize () const
+		{
+			return m_pageSize;
+		}
+		std::size_t         getPageCount() const
+		{
+			return m_pages.size();
+		}
+		const sf::Texture & getPage     (std::size_t page) const
+		{
+			return *m_pages.at(page);
+		}
+		float               getOccupancy(std::size_t page) const
+		{
+			// Returns the fraction of a page that is covered by images, including the padding around them
+			return m_packers.at(page).getOccupancy();
+		}
+		const AtlasRegion * getRegion   (const sf::String & alias) const
+		{
+			// Returns where an alias was packed, or nullptr if it is not in the atlas
+			auto found = m_regions.find(alias);
+			return found != m_regions.end() ? &found->second : nullptr;
+		}
+		bool                hasRegion   (const sf::String & alias) const
+		{
+			return m_regions.find(alias) != m_regions.end();
+		}
+		bool                isSmooth    () const
+		{
+			return m_smooth;
+		}
+		// Mutators
+		void setSmooth(bool smooth)
+		{
+			// Change the smoothing of every page, including the pages that are created later
+			// Pages are changed in place, so references to them stay valid and atlases sharing them see the change
+			m_smooth = smooth;
+			for (const std::shared_ptr<sf::Texture> & page : m_pages)
+				if (!TextureStore::getGlobal().setFlags(*page, smooth, page->isRepeated()))
+					page->setSmooth(smooth);
+		}
+		// Utilities
+		bool add      (const sf::String & alias, const sf::Image & image, const sf::IntRect & area = sf::IntRect())
+		{
+			// Pack an image (or the area of it) into the atlas under an alias, replacing whatever the alias referred to
+			// Returns false if the image is empty or larger than a page
+			sf::IntRect whole(0, 0, static_cast<int>(image.getSize().x), static_cast<int>(image.getSize().y));
+			sf::IntRect source = whole;
+			if (area.width > 0 && area.height > 0 && !whole.intersects(area, source))
+				return false;
+			int width = source.width + static_cast<int>(m_padding);
+			int height = source.height + static_cast<int>(m_padding);
+			int size = static_cast<int>(getUsablePageSize());
+			if (source.width <= 0 || source.height <= 0 || width > size || height > size)
+				return false;
+			sf::IntRect placed;
+			std::size_t page = 0;
+			while (page < m_packers.size() && (m_pages[page].use_count() > 1 || !m_packers[page].pack(width, height, placed)))
+				++page;
+			if (page == m_packers.size())
+			{
+				if (!createPage() || !m_packers.back().pack(width, height, placed))
+					return false;
+			}
+			placed.width = source.width;
+			placed.height = source.height;
+			if (source == whole)
+			{
+				m_pages[page]->update(image, static_cast<unsigned int>(placed.left), static_cast<unsigned int>(placed.top));
+			}
+			else
+			{
+				sf::Image cropped;
+				cropped.create(static_cast<unsigned int>(source.width), static_cast<unsigned int>(source.height));
+				cropped.copy(image, 0, 0, source);
+				m_pages[page]->update(cropped, static_cast<unsigned int>(placed.left), static_cast<unsigned int>(placed.top));
+			}
+			m_regions[alias] = AtlasRegion{ page, placed };
+			return true;
+		}
+		bool add      (const sf::String & alias, const sf::String & filePath, const sf::IntRect & area = sf::IntRect())
+		{
+			// Load an image from a file and pack it into the atlas
+			sf::Image image;
+			if (!image.loadFromFile(filePath))
+				return false;
+			return add(alias, image, area);
+		}
+		bool addPage  (const std::shared_ptr<sf::Texture> & texture)
+		{
+			// Add a page that was packed ahead of time, its index is getPageCount() - 1 afterwards
+			if (!texture)
+				return false;
+			if (!TextureStore::getGlobal().setFlags(*texture, m_smooth, false))
+			{
+				texture->setSmooth(m_smooth);
+				texture->setRepeated(false);
+			}
+			int width = static_cast<int>(texture->getSize().x);
+			int height = static_cast<int>(texture->getSize().y);
+			SkylinePacker packer(width, height);
+			sf::IntRect full;
+			packer.pack(width, height, full);
+			m_pages.push_back(texture);
+			m_packers.push_back(packer);
+			return true;
+		}
+		bool addRegion(const sf::String & alias, std::size_t page, const sf::IntRect & rect)
+		{
+			// Point an alias at a rectangle of a page, replacing whatever the alias referred to
+			// Returns false if the page does not exist or the rectangle is not inside it
+			if (page >= m_pages.size() || !fitsInPage(*m_pages[page], rect))
+				return false;
+			m_regions[alias] = AtlasRegion{ page, rect };
+			return true;
+		}
+		bool remove   (const sf::String & alias)
+		{
+			// Forget an alias, its space in the page is not reused
+			return m_regions.erase(alias) != 0;
+		}
+		void clear    ()
+		{
+			// Remove every alias and every page
+			m_regions.clear();
+			m_packers.clear();
+			m_pages.clear();
+		}
+		static bool fitsInPage(const sf::Texture & page, const sf::IntRect & rect)
+		{
+			// Returns true if the rectangle is not empty and lies inside the page
+			return rect.width > 0 && rect.height > 0 && rect.left >= 0 && rect.top >= 0 &&
+			       rect.left + rect.width <= static_cast<int>(page.getSize().x) && rect.top + rect.height <= static_cast<int>(page.getSize().y);
+		}
+		// Iterators
+		ConstAtlasRegionIterator cbegin() const
+		{
+			return m_regions.cbegin();
+		}
+		ConstAtlasRegionIterator cend  () const
+		{
+			return m_regions.cend();
+		}
+	private:
+		unsigned int getUsablePageSize() const
+		{
+			// Returns the size of a page, limited to the largest texture that the graphics card supports
+			return std::min(m_pageSize, sf::Texture::getMaximumSize());
+		}
+		bool createPage()
+		{
+			// Create an empty, fully transparent page
+			unsigned int size = getUsablePageSize();
+			std::shared_ptr<sf::Texture> page = std::make_shared<sf::Texture>();
+			if (!page->create(size, size))
+				return false;
+			sf::Image clear;
+			clear.create(size, size, sf::Color::Transparent);
+			page->update(clear);
+			page->setSmooth(m_smooth);
+			m_pages.push_back(std::move(page));
+			m_packers.emplace_back(static_cast<int>(size), static_cast<int>(size));
+			return true;
+		}
+	};
+}
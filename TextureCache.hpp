@@ -0,0 +1,319 @@
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <map>
+#include <stdexcept>
+
+#include <SFML/Graphics/Rect.hpp>
+#include <SFML/Graphics/Texture.hpp>
+#include <SFML/System/String.hpp>
+
+// The TextureCache class keeps the textures that are in use in video memory, and lets the rest go when memory runs low.
+
+// A texture is added by remembering where it came from (the file, the area of it, and the smooth and repeated flags)
+// and loading it once. From then on it is either resident or evicted. Evicted textures are loaded again the next time
+// they are accessed, so callers never have to know whether a texture was evicted in between.
+
+// Every texture has a reference count, which TextureCache::Reference objects keep up to date. While a texture has
+// references it is never evicted, so anything that holds a reference (a sprite, a tile map, a level) can keep using
+// the texture for as long as it needs it. Textures without references are kept in least recently used order, and
+// whenever the resident textures take up more than the budget, the least recently used ones are evicted until they
+// fit again. Referenced textures can take the cache over budget, since nothing can be evicted in their place.
+
+// Evicting a texture replaces it with an empty one, so getTexture never returns a dangling reference, but a sprite
+// that points at a texture without holding a Reference may end up drawing nothing.
+
+// Sizes are estimated as 4 bytes per pixel, which is what the textures take up in video memory without mipmaps.
+// The cache is not thread-safe and, since it creates OpenGL textures, should only be used on the render thread.
+
+// TODO: tests
+
+namespace sfext
+{
+	struct TextureCacheStats
+	{
+		std::size_t hits;          // Accesses to a texture that was resident
+		std::size_t misses;        // Accesses to a texture that had to be loaded again
+		std::size_t evictions;     // Textures that were evicted to stay within the budget
+		std::size_t residentBytes; // Estimated video memory used by the resident textures
+		std::size_t residentCount; // Number of resident textures
+	};
+
+	class TextureCache final
+	{
+	private:
+		struct Entry;
+		typedef std::map<sf::String, Entry>::iterator EntryIterator;
+
+		struct Entry
+		{
+			sf::String filePath;
+			sf::IntRect area;
+			bool smooth;
+			bool repeated;
+			sf::Texture texture;
+			bool resident;
+			std::size_t bytes;
+			std::size_t references;
+			std::list<EntryIterator>::iterator lruPosition; // Only valid while the texture is resident and unreferenced
+		};
+
+		std::map<sf::String, Entry> m_entries;
+		std::list<EntryIterator> m_lru; // Resident, unreferenced textures, least recently used first
+		std::size_t m_budget;
+		TextureCacheStats m_stats;
+	public:
+		class Reference final
+		{
+			// Keeps a texture of a TextureCache resident for as long as the reference (or a copy of it) exists
+			// References must not outlive their cache
+		private:
+			TextureCache * m_cache;
+			EntryIterator m_entry;
+
+			friend class TextureCache;
+			Reference(TextureCache & cache, EntryIterator entry) : m_cache(&cache), m_entry(entry)
+			{
+				m_cache->retain(m_entry);
+			}
+		public:
+			// Constructors
+			Reference() : m_cache(nullptr)
+			{
+				// Creates a reference to nothing
+			}
+			Reference(const Reference & rhs) : m_cache(rhs.m_cache), m_entry(rhs.m_entry)
+			{
+				if (m_cache)
+					m_cache->retain(m_entry);
+			}
+			Reference(Reference && rhs) : m_cache(rhs.m_cache), m_entry(rhs.m_entry)
+			{
+				rhs.m_cache = nullptr;
+			}
+			Reference & operator = (Reference rhs)
+			{
+				std::swap(m_cache, rhs.m_cache);
+				std::swap(m_entry, rhs.m_entry);
+				return *this;
+			}
+			// Destructor
+			~Reference()
+			{
+				if (m_cache)
+					m_cache->release(m_entry);
+			}
+			// Accessors
+			bool                isValid   () const
+			{
+				return m_cache != nullptr;
+			}
+			const sf::String &  getAlias  () const
+			{
+				if (!m_cache)
+					throw std::invalid_argument("The texture reference does not refer to a texture.");
+				return m_entry->first;
+			}
+			const sf::Texture & getTexture() const
+			{
+				if (!m_cache)
+					throw std::invalid_argument("The texture reference does not refer to a texture.");
+				return m_entry->second.texture;
+			}
+			// Mutators
+			void reset()
+			{
+				// Let go of the texture
+				Reference().swap(*this);
+			}
+			void swap (Reference & rhs)
+			{
+				std::swap(m_cache, rhs.m_cache);
+				std::swap(m_entry, rhs.m_entry);
+			}
+		};
+
+		// Constructors
+		explicit TextureCache(std::size_t budget = 256 * 1024 * 1024) : m_budget(budget), m_stats{ 0, 0, 0, 0, 0 }
+		{
+		}
+		TextureCache(const TextureCache &) = delete;
+		TextureCache & operator = (const TextureCache &) = delete;
+		// Destructor
+		~TextureCache()
+		{
+		}
+		// Accessors
+		std::size_t               getBudget        () const
+		{
+			return m_budget;
+		}
+		const TextureCacheStats & getStats         () const
+		{
+			return m_stats;
+		}
+		std::size_t               getReferenceCount(const sf::String & alias) const
+		{
+			return find(alias).references;
+		}
+		bool                      isResident       (const sf::String & alias) const
+		{
+			return find(alias).resident;
+		}
+		// Mutators
+		void setBudget (std::size_t budget)
+		{
+			// Change the budget, evicting textures straight away if they no longer fit
+			m_budget = budget;
+			trim();
+		}
+		void resetStats()
+		{
+			// Reset the hit, miss and eviction counters, the resident counters are kept
+			m_stats.hits = 0;
+			m_stats.misses = 0;
+			m_stats.evictions = 0;
+		}
+		// Utilities
+		bool                addTexture   (const sf::String & filePath, const sf::String & alias, const sf::IntRect & area = sf::IntRect())
+		{
+			return addTexture(filePath, alias, false, false, area);
+		}
+		bool                addTexture   (const sf::String & filePath, const sf::String & alias, bool smooth, bool repeated, const sf::IntRect & area = sf::IntRect())
+		{
+			// Load a texture and remember where it came from, so that it can be loaded again after it has been evicted
+			// Returns false if the file cannot be loaded, or if the alias is taken by a texture that still has references
+			auto existing = m_entries.find(alias);
+			if (existing != m_entries.end() && existing->second.references != 0)
+				return false;
+			sf::Texture texture;
+			if (!texture.loadFromFile(filePath, area))
+				return false;
+			if (existing != m_entries.end())
+				removeTexture(alias);
+			EntryIterator added = m_entries.emplace(alias, Entry{ filePath, area, smooth, repeated, sf::Texture(), false, 0, 0, std::list<EntryIterator>::iterator() }).first;
+			added->second.texture.swap(texture);
+			makeResident(added);
+			trim(added);
+			return true;
+		}
+		bool                hasTexture   (const sf::String & alias) const
+		{
+			return m_entries.find(alias) != m_entries.cend();
+		}
+		bool                removeTexture(const sf::String & alias)
+		{
+			// Forget a texture entirely
+			// Returns false if it still has references
+			auto entry = m_entries.find(alias);
+			if (entry == m_entries.end())
+				throw std::invalid_argument("The texture <" + alias + "> does not exist.");
+			if (entry->second.references != 0)
+				return false;
+			if (entry->second.resident)
+			{
+				m_lru.erase(entry->second.lruPosition);
+				m_stats.residentBytes -= entry->second.bytes;
+				--m_stats.residentCount;
+			}
+			m_entries.erase(entry);
+			return true;
+		}
+		const sf::Texture & getTexture   (const sf::String & alias)
+		{
+			// Returns a texture, loading it again if it was evicted, and marks it as the most recently used one
+			// Without a Reference, the texture may be evicted by any later call that loads a texture
+			EntryIterator entry = access(alias);
+			if (entry->second.references == 0)
+				m_lru.splice(m_lru.end(), m_lru, entry->second.lruPosition);
+			trim(entry);
+			return entry->second.texture;
+		}
+		Reference           acquire      (const sf::String & alias)
+		{
+			// Returns a reference that keeps the texture resident, loading it again if it was evicted
+			Reference reference(*this, access(alias));
+			trim();
+			return reference;
+		}
+		void                evictUnused  ()
+		{
+			// Evict every texture that has no references, e.g. when a level is unloaded
+			while (!m_lru.empty())
+				evict(m_lru.front());
+		}
+	private:
+		const Entry & find        (const sf::String & alias) const
+		{
+			auto entry = m_entries.find(alias);
+			if (entry == m_entries.cend())
+				throw std::invalid_argument("The texture <" + alias + "> does not exist.");
+			return entry->second;
+		}
+		EntryIterator access      (const sf::String & alias)
+		{
+			// Makes sure that a texture is resident and counts the access
+			EntryIterator entry = m_entries.find(alias);
+			if (entry == m_entries.end())
+				throw std::invalid_argument("The texture <" + alias + "> does not exist.");
+			if (entry->second.resident)
+			{
+				++m_stats.hits;
+				return entry;
+			}
+			++m_stats.misses;
+			if (!entry->second.texture.loadFromFile(entry->second.filePath, entry->second.area))
+				throw std::runtime_error("The texture <" + alias + "> could not be loaded again from <" + entry->second.filePath + ">.");
+			makeResident(entry);
+			return entry;
+		}
+		void          makeResident(EntryIterator entry)
+		{
+			// Apply the flags to a texture that was just loaded and start counting it
+			entry->second.texture.setSmooth(entry->second.smooth);
+			entry->second.texture.setRepeated(entry->second.repeated);
+			entry->second.bytes = static_cast<std::size_t>(entry->second.texture.getSize().x) * entry->second.texture.getSize().y * 4;
+			entry->second.resident = true;
+			m_stats.residentBytes += entry->second.bytes;
+			++m_stats.residentCount;
+			if (entry->second.references == 0)
+				entry->second.lruPosition = m_lru.insert(m_lru.end(), entry);
+		}
+		void          evict       (EntryIterator entry)
+		{
+			// Free the video memory of a resident, unreferenced texture
+			m_lru.erase(entry->second.lruPosition);
+			sf::Texture().swap(entry->second.texture);
+			entry->second.resident = false;
+			m_stats.residentBytes -= entry->second.bytes;
+			--m_stats.residentCount;
+			++m_stats.evictions;
+		}
+		void          trim        ()
+		{
+			// Evict the least recently used textures until the resident ones fit within the budget
+			while (m_stats.residentBytes > m_budget && !m_lru.empty())
+				evict(m_lru.front());
+		}
+		void          trim        (EntryIterator keep)
+		{
+			// Same as above, but never evicts keep, so that the texture that was just accessed stays valid
+			while (m_stats.residentBytes > m_budget && !m_lru.empty() && m_lru.front() != keep)
+				evict(m_lru.front());
+		}
+		void          retain      (EntryIterator entry)
+		{
+			if (entry->second.references++ == 0 && entry->second.resident)
+				m_lru.erase(entry->second.lruPosition);
+		}
+		void          release     (EntryIterator entry)
+		{
+			if (--entry->second.references == 0 && entry->second.resident)
+			{
+				entry->second.lruPosition = m_lru.insert(m_lru.end(), entry);
+				trim();
+			}
+		}
+	};
+}
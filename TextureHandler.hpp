@@ -1,30 +1,53 @@
 #pragma once
 
+#include <cstdint>
 #include <map>
+#include <memory>
+#include <vector>
 
 #include <SFML/Graphics/Texture.hpp>
 #include <SFML/System/String.hpp>
 
+#include "AtlasManifest.hpp"
+#include "TextureAtlas.hpp"
+#include "TextureStore.hpp"
+
+// Textures are loaded through the global TextureStore, so every handler that loads the same image shares a single
+// texture with the others, and copying a handler does not copy any textures. The iterators therefore give access to
+// shared pointers to read-only textures. setSmooth and setRepeated change the texture in place, so references to it
+// stay valid, and every handler that shares the texture sees the new flags.
+
+// In atlas mode, textures that are added without the smooth and repeated flags are packed into the pages of a
+// TextureAtlas instead of getting a texture of their own. getTexture then returns the page, and getTextureRect the
+// part of it that belongs to the alias, so anything drawing from the handler has to use both. The iterators only walk
+// the textures that are not in the atlas; getAtlas gives access to the rest. Images packed this way are copied into
+// this handler's pages, so unlike the other textures they are not shared with other handlers.
+
+// An atlas that was baked ahead of time is loaded with loadAtlas, which decodes each page image once and adds every
+// alias of the manifest to the atlas, whether or not atlas mode is on.
+
 // TODO: tests
 // TODO: documentation
 
 namespace sfext
 {
-	typedef std::map<sf::String, sf::Texture>::iterator               TextureIterator;
-	typedef std::map<sf::String, sf::Texture>::const_iterator         ConstTextureIterator;
-	typedef std::map<sf::String, sf::Texture>::reverse_iterator       ReverseTextureIterator;
-	typedef std::map<sf::String, sf::Texture>::const_reverse_iterator ConstReverseTextureIterator;
+	typedef std::map<sf::String, std::shared_ptr<const sf::Texture>>::iterator               TextureIterator;
+	typedef std::map<sf::String, std::shared_ptr<const sf::Texture>>::const_iterator         ConstTextureIterator;
+	typedef std::map<sf::String, std::shared_ptr<const sf::Texture>>::reverse_iterator       ReverseTextureIterator;
+	typedef std::map<sf::String, std::shared_ptr<const sf::Texture>>::const_reverse_iterator ConstReverseTextureIterator;
 
 	class TextureHandler final
 	{
 	private:
-		std::map<sf::String, sf::Texture> m_textures;
+		std::map<sf::String, std::shared_ptr<const sf::Texture>> m_textures;
+		TextureAtlas m_atlas;
+		bool m_atlasMode;
 	public:
 		// Constructors
-		TextureHandler()
+		TextureHandler() : m_atlasMode(false)
 		{
 		}
-		TextureHandler(const TextureHandler & rhs) : m_textures(rhs.m_textures)
+		TextureHandler(const TextureHandler & rhs) : m_textures(rhs.m_textures), m_atlas(rhs.m_atlas), m_atlasMode(rhs.m_atlasMode)
 		{
 		}
 		// Destructor
@@ -32,76 +55,140 @@ namespace sfext
 		{
 		}
 		// Accessors
-		const sf::Texture & getTexture(const sf::String & alias) const
+		const sf::Texture &  getTexture    (const sf::String & alias) const
+		{
+			// Returns the texture of an alias, which is a whole atlas page if the alias was packed into the atlas
+			if (m_textures.find(alias) != m_textures.cend())
+				return *m_textures.at(alias);
+			else if (const AtlasRegion * region = m_atlas.getRegion(alias))
+				return m_atlas.getPage(region->page);
+			else
+				throw std::invalid_argument("The texture <" + alias + "> does not exist.");
+		}
+		sf::IntRect          getTextureRect(const sf::String & alias) const
 		{
-			if (hasTexture(alias))
-				return m_textures.at(alias);
+			// Returns the part of getTexture(alias) that belongs to the alias, which is all of it outside of the atlas
+			if (m_textures.find(alias) != m_textures.cend())
+				return sf::IntRect(0, 0, static_cast<int>(m_textures.at(alias)->getSize().x), static_cast<int>(m_textures.at(alias)->getSize().y));
+			else if (const AtlasRegion * region = m_atlas.getRegion(alias))
+				return region->rect;
 			else
 				throw std::invalid_argument("The texture <" + alias + "> does not exist.");
 		}
+		const TextureAtlas & getAtlas      () const
+		{
+			return m_atlas;
+		}
+		bool                 isAtlasMode   () const
+		{
+			return m_atlasMode;
+		}
+		bool                 isInAtlas     (const sf::String & alias) const
+		{
+			return m_atlas.hasRegion(alias);
+		}
 		// Mutators
-		void setRepeated(const sf::String & alias, bool repeated)
+		void setRepeated  (const sf::String & alias, bool repeated)
 		{
-			if (hasTexture(alias))
-				m_textures.at(alias).setRepeated(repeated);
+			TextureIterator texture = m_textures.find(alias);
+			if (texture != m_textures.end())
+				TextureStore::getGlobal().setFlags(*texture->second, texture->second->isSmooth(), repeated);
+			else if (isInAtlas(alias))
+				throw std::invalid_argument("The texture <" + alias + "> is in the atlas and cannot be repeated.");
 			else
 				throw std::invalid_argument("The texture <" + alias + "> does not exist.");
 		}
-		void setSmooth  (const sf::String & alias, bool smooth)
+		void setSmooth    (const sf::String & alias, bool smooth)
 		{
-			if (hasTexture(alias))
-				m_textures.at(alias).setSmooth(smooth);
+			TextureIterator texture = m_textures.find(alias);
+			if (texture != m_textures.end())
+				TextureStore::getGlobal().setFlags(*texture->second, smooth, texture->second->isRepeated());
+			else if (isInAtlas(alias))
+				throw std::invalid_argument("The texture <" + alias + "> is in the atlas, use setAtlasSmooth instead.");
 			else
 				throw std::invalid_argument("The texture <" + alias + "> does not exist.");
 		}
+		void setAtlasMode (bool atlasMode)
+		{
+			// Turn atlas mode on or off for the textures that are added from now on
+			m_atlasMode = atlasMode;
+		}
+		void setAtlasSmooth(bool smooth)
+		{
+			// Change the smoothing of every atlas page
+			m_atlas.setSmooth(smooth);
+		}
 		// Utilities
 		bool      addTexture   (const sf::String & filePath, const sf::String & alias, const sf::IntRect & area = sf::IntRect())
 		{
-			sf::Texture texture;
-			if (texture.loadFromFile(filePath, area))
+			if (m_atlasMode)
 			{
-				m_textures[alias] = texture;
-				return true;
+				sf::Image image;
+				return image.loadFromFile(filePath) && addToAtlas(image, alias, area);
 			}
-			return false;
+			return addToHandler(TextureStore::getGlobal().load(filePath, area), alias);
 		}
 		bool      addTexture   (const sf::String & filePath, const sf::String & alias, bool smooth, bool repeated, const sf::IntRect & area = sf::IntRect())
 		{
-			sf::Texture texture;
-			if (texture.loadFromFile(filePath, area))
-			{
-				texture.setRepeated(repeated);
-				texture.setSmooth(smooth);
-				m_textures[alias] = texture;
-				return true;
-			}
-			return false;
+			return addToHandler(TextureStore::getGlobal().load(filePath, area, smooth, repeated), alias);
 		}
 		bool      addTexture   (const sf::Image & image, const sf::String & alias, const sf::IntRect & area = sf::IntRect())
 		{
-			sf::Texture texture;
-			if (texture.loadFromImage(image, area))
-			{
-				m_textures[alias] = texture;
-				return true;
-			}
-			return false;
+			if (m_atlasMode)
+				return addToAtlas(image, alias, area);
+			return addToHandler(TextureStore::getGlobal().load(image, area), alias);
 		}
 		bool      addTexture   (const sf::Image & image, const sf::String & alias, bool smooth, bool repeated, const sf::IntRect & area = sf::IntRect())
 		{
-			sf::Texture texture;
-			if (texture.loadFromImage(image, area))
+			return addToHandler(TextureStore::getGlobal().load(image, area, smooth, repeated), alias);
+		}
+		bool      addTexture   (const sf::Image & image, std::uint64_t imageHash, const sf::String & alias, const sf::IntRect & area = sf::IntRect())
+		{
+			// Same as above, with the hash of the image already found by TextureStore::hashImage
+			if (m_atlasMode)
+				return addToAtlas(image, alias, area);
+			return addToHandler(TextureStore::getGlobal().load(image, imageHash, area), alias);
+		}
+		bool      addTexture   (const sf::Image & image, std::uint64_t imageHash, const sf::String & alias, bool smooth, bool repeated, const sf::IntRect & area = sf::IntRect())
+		{
+			return addToHandler(TextureStore::getGlobal().load(image, imageHash, area, smooth, repeated), alias);
+		}
+		bool      loadAtlas    (const sf::String & manifestPath)
+		{
+			// Load a manifest written by AtlasBaker, along with its pages
+			AtlasManifest manifest;
+			return manifest.loadFromFile(manifestPath) && loadAtlas(manifest);
+		}
+		bool      loadAtlas    (const AtlasManifest & manifest)
+		{
+			// Add the pages and aliases of a baked atlas, replacing textures of their own if the aliases had them
+			// Returns false if a page cannot be loaded or an entry lies outside its page, in which case nothing is added
+			// Everything is checked before the atlas is touched, so a bad manifest never leaves orphan pages behind
+			std::vector<std::shared_ptr<sf::Texture>> pages(manifest.getPageCount());
+			for (std::size_t i = 0; i < pages.size(); ++i)
 			{
-				texture.setRepeated(repeated);
-				texture.setSmooth(smooth);
-				m_textures[alias] = texture;
-				return true;
+				pages[i] = TextureStore::getGlobal().load(manifest.getPagePath(i), sf::IntRect(), m_atlas.isSmooth(), false);
+				if (!pages[i])
+					return false;
 			}
-			return false;
+			for (ConstAtlasManifestIterator entry = manifest.cbegin(); entry != manifest.cend(); ++entry)
+			{
+				if (entry->second.page >= pages.size() || !TextureAtlas::fitsInPage(*pages[entry->second.page], entry->second.rect))
+					return false;
+			}
+			std::size_t firstPage = m_atlas.getPageCount();
+			for (const std::shared_ptr<sf::Texture> & page : pages)
+				m_atlas.addPage(page); // Only fails for a null page
+			for (ConstAtlasManifestIterator entry = manifest.cbegin(); entry != manifest.cend(); ++entry)
+			{
+				m_atlas.addRegion(entry->first, firstPage + entry->second.page, entry->second.rect);
+				m_textures.erase(entry->first);
+			}
+			return true;
 		}
 		bool      hasTexture   (const sf::String & alias) const
 		{
-			return m_textures.find(alias) != m_textures.cend();
+			return m_textures.find(alias) != m_textures.cend() || m_atlas.hasRegion(alias);
 		}
 		bool      removeTexture(const sf::String & alias)
 		{
@@ -111,13 +198,22 @@ namespace sfext
 				m_textures.erase(texture);
 				return true;
 			}
+			else if (m_atlas.remove(alias))
+				return true;
 			else
 				throw std::invalid_argument("The texture <" + alias + "> does not exist.");
 		}
 		sf::Image copyToImage  (const sf::String & alias) const
 		{
-			if (hasTexture(alias))
-				return m_textures.at(alias).copyToImage();
+			if (m_textures.find(alias) != m_textures.cend())
+				return m_textures.at(alias)->copyToImage();
+			else if (const AtlasRegion * region = m_atlas.getRegion(alias))
+			{
+				sf::Image image;
+				image.create(static_cast<unsigned int>(region->rect.width), static_cast<unsigned int>(region->rect.height));
+				image.copy(m_atlas.getPage(region->page).copyToImage(), 0, 0, region->rect);
+				return image;
+			}
 			else
 				throw std::invalid_argument("The texture <" + alias + "> does not exist.");
 		}
@@ -162,5 +258,23 @@ namespace sfext
 		{
 			return m_textures.find(alias);
 		}
+	private:
+		bool addToHandler(const std::shared_ptr<const sf::Texture> & texture, const sf::String & alias)
+		{
+			// Give an alias a texture of its own, taking it out of the atlas if it was packed into it
+			if (!texture)
+				return false;
+			m_atlas.remove(alias);
+			m_textures[alias] = texture;
+			return true;
+		}
+		bool addToAtlas  (const sf::Image & image, const sf::String & alias, const sf::IntRect & area)
+		{
+			// Pack an image into the atlas, replacing a texture of its own if the alias had one
+			if (!m_atlas.add(alias, image, area))
+				return false;
+			m_textures.erase(alias);
+			return true;
+		}
 	};
 }
\ No newline at end of file
@@ -0,0 +1,305 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <utility>
+
+#include <SFML/Graphics/Image.hpp>
+#include <SFML/Graphics/Rect.hpp>
+#include <SFML/Graphics/Texture.hpp>
+#include <SFML/System/String.hpp>
+
+// The TextureStore class makes sure that every image is uploaded to the graphics card only once, no matter how many
+// handlers use it.
+
+// Textures are looked up by their contents rather than by alias or path. An image is hashed by its decoded pixels,
+// whether it comes from a file, from an sf::Image, or from the AsyncLoader, and the hash is combined with the area that
+// is loaded and the smooth and repeated flags. If a texture with the same key is still alive, and its pixels really
+// are the same, it is handed out again without uploading anything. So two handlers that load the same file, or the
+// same image under two different paths, share one texture, and copying a handler copies pointers instead of textures.
+// Hashing a large image takes a while, so hashImage can be called on another thread (the AsyncLoader does it while
+// decoding) and the result passed to load along with the image.
+
+// The store also remembers which contents each file path decoded to, so loading a path whose texture is still alive
+// does not read the file at all. A file that changes on disk while its texture is alive is therefore not picked up
+// until every handler has let go of the texture.
+
+// The store only keeps weak references. A texture lives for as long as some handler holds it, and the store forgets
+// it when the last one lets go. setFlags changes the smooth and repeated flags of a texture in place, so every handler
+// that shares it sees the change, and references to it stay valid.
+
+// Every TextureHandler (and so every SpriteHandler, AnimationHandler and the GlobalResourceCache) uses the global
+// store. Like the textures in it, it should only be used on the thread that owns the OpenGL context. The exception is
+// hashImage, which does not touch the store.
+
+// Images that a handler packs into its atlas at runtime do not go through the store: each handler copies them into
+// pages of its own. Only atlas pages that are loaded from a baked manifest are shared, so images that many handlers
+// pack should be baked ahead of time.
+
+// TODO: tests
+
+namespace sfext
+{
+	class TextureStore final
+	{
+	private:
+		struct Key
+		{
+			std::uint64_t hash;
+			std::uint64_t size;
+			sf::IntRect area;
+			bool smooth;
+			bool repeated;
+
+			bool operator < (const Key & rhs) const
+			{
+				return std::tie(hash, size, area.left, area.top, area.width, area.height, smooth, repeated) <
+				       std::tie(rhs.hash, rhs.size, rhs.area.left, rhs.area.top, rhs.area.width, rhs.area.height, rhs.smooth, rhs.repeated);
+			}
+		};
+
+		struct Entry
+		{
+			Key key;
+			std::weak_ptr<sf::Texture> texture;
+		};
+
+		struct Registry
+		{
+			std::map<Key, std::weak_ptr<sf::Texture>> textures; // The texture that a key finds
+			std::map<const sf::Texture *, Entry> entries; // Every living texture of the store, with its current key
+			std::map<sf::String, std::pair<std::uint64_t, std::uint64_t>> paths; // Hash and size that a file decoded to
+		};
+
+		struct Deleter
+		{
+			// Removes a texture from the registry when its last owner lets go, if the store still exists
+			std::weak_ptr<Registry> registry;
+
+			void operator () (sf::Texture * texture) const
+			{
+				if (std::shared_ptr<Registry> alive = registry.lock())
+					unregister(*alive, texture);
+				delete texture;
+			}
+		};
+
+		std::shared_ptr<Registry> m_registry;
+		std::size_t m_loads;
+		std::size_t m_reuses;
+	public:
+		// Constructors
+		TextureStore() : m_registry(std::make_shared<Registry>()), m_loads(0), m_reuses(0)
+		{
+		}
+		TextureStore(const TextureStore &) = delete;
+		TextureStore & operator = (const TextureStore &) = delete;
+		// Destructor
+		~TextureStore()
+		{
+		}
+		// Accessors
+		static TextureStore & getGlobal      ()
+		{
+			// Returns the store that the handlers share
+			static TextureStore store;
+			return store;
+		}
+		std::size_t           getTextureCount() const
+		{
+			// Returns the number of textures that are alive
+			return m_registry->entries.size();
+		}
+		std::size_t           getLoadCount   () const
+		{
+			// Returns the number of textures that had to be uploaded
+			return m_loads;
+		}
+		std::size_t           getReuseCount  () const
+		{
+			// Returns the number of times a texture that was already alive was handed out instead
+			return m_reuses;
+		}
+		bool                  contains       (const sf::Texture & texture) const
+		{
+			// Returns true if the texture came from the store and is still alive
+			return m_registry->entries.find(&texture) != m_registry->entries.end();
+		}
+		static std::uint64_t  hashImage      (const sf::Image & image)
+		{
+			// Returns the hash that load uses to look up the texture of an image
+			// Safe to call on any thread, so that the hash can be found along with decoding the image
+			sf::Vector2u size = image.getSize();
+			std::uint64_t dimensions[2] = { size.x, size.y };
+			std::uint64_t pixelHash = hash(dimensions, sizeof(dimensions), 14695981039346656037ull);
+			if (image.getPixelsPtr())
+				pixelHash = hash(image.getPixelsPtr(), static_cast<std::size_t>(size.x) * size.y * 4, pixelHash);
+			return pixelHash;
+		}
+		// Mutators
+		bool setFlags(const sf::Texture & texture, bool smooth, bool repeated)
+		{
+			// Change the flags of a texture from the store in place, for every handler that shares it
+			// Returns false if the texture did not come from the store, in which case it is left alone
+			auto entry = m_registry->entries.find(&texture);
+			if (entry == m_registry->entries.end())
+				return false;
+			std::shared_ptr<sf::Texture> owned = entry->second.texture.lock();
+			if (!owned)
+				return false;
+			apply(*owned, smooth, repeated);
+			Key & key = entry->second.key;
+			if (key.smooth == smooth && key.repeated == repeated)
+				return true;
+			auto found = m_registry->textures.find(key);
+			if (found != m_registry->textures.end() && found->second.lock() == owned)
+				m_registry->textures.erase(found);
+			key.smooth = smooth;
+			key.repeated = repeated;
+			std::weak_ptr<sf::Texture> & flagged = m_registry->textures[key];
+			if (flagged.expired())
+				flagged = owned;
+			return true;
+		}
+		// Utilities
+		std::shared_ptr<sf::Texture> load(const sf::String & filePath, const sf::IntRect & area = sf::IntRect(), bool smooth = false, bool repeated = false)
+		{
+			// Returns the texture of a file, decoding and uploading it only if no texture with the same pixels is alive
+			// Returns nullptr if the file cannot be read or decoded
+			auto path = m_registry->paths.find(filePath);
+			if (path != m_registry->paths.end())
+			{
+				if (std::shared_ptr<sf::Texture> existing = find(Key{ path->second.first, path->second.second, area, smooth, repeated }))
+					return existing;
+			}
+			sf::Image image;
+			if (!image.loadFromFile(filePath))
+				return nullptr;
+			std::uint64_t imageHash = hashImage(image);
+			m_registry->paths[filePath] = std::make_pair(imageHash, bytes(image));
+			return load(image, imageHash, area, smooth, repeated);
+		}
+		std::shared_ptr<sf::Texture> load(const sf::Image & image, const sf::IntRect & area = sf::IntRect(), bool smooth = false, bool repeated = false)
+		{
+			// Returns the texture of an image, uploading it only if no texture with the same pixels is alive
+			// Returns nullptr if the image cannot be uploaded
+			return load(image, hashImage(image), area, smooth, repeated);
+		}
+		std::shared_ptr<sf::Texture> load(const sf::Image & image, std::uint64_t imageHash, const sf::IntRect & area = sf::IntRect(), bool smooth = false, bool repeated = false)
+		{
+			// Same as above, with the hash of the image already found by hashImage
+			// A texture with the same hash is only reused if its pixels match, so a hash collision costs an upload
+			// instead of handing out the wrong texture
+			Key key{ imageHash, bytes(image), area, smooth, repeated };
+			auto found = m_registry->textures.find(key);
+			if (found != m_registry->textures.end())
+			{
+				std::shared_ptr<sf::Texture> existing = found->second.lock();
+				if (existing && samePixels(*existing, image, area))
+				{
+					++m_reuses;
+					return existing;
+				}
+			}
+			std::shared_ptr<sf::Texture> texture(new sf::Texture(), Deleter{ m_registry });
+			if (!texture->loadFromImage(image, area))
+				return nullptr;
+			apply(*texture, smooth, repeated);
+			++m_loads;
+			m_registry->textures[key] = texture;
+			m_registry->entries[texture.get()] = Entry{ key, texture };
+			return texture;
+		}
+	private:
+		static std::uint64_t hash      (const void * data, std::size_t size, std::uint64_t hash)
+		{
+			// FNV-1a over the bytes of data, continuing from hash
+			const unsigned char * bytes = static_cast<const unsigned char *>(data);
+			for (std::size_t i = 0; i < size; ++i)
+			{
+				hash ^= bytes[i];
+				hash *= 1099511628211ull;
+			}
+			return hash;
+		}
+		static std::uint64_t bytes     (const sf::Image & image)
+		{
+			return static_cast<std::uint64_t>(image.getSize().x) * image.getSize().y * 4;
+		}
+		static void          apply     (sf::Texture & texture, bool smooth, bool repeated)
+		{
+			texture.setSmooth(smooth);
+			texture.setRepeated(repeated);
+		}
+		static bool          samePixels(const sf::Texture & texture, const sf::Image & image, const sf::IntRect & area)
+		{
+			// Returns true if the texture holds exactly the pixels that loading the area of the image would give it
+			// The area is clamped the same way sf::Texture::loadFromImage clamps it
+			sf::Vector2u size = image.getSize();
+			sf::IntRect rect(0, 0, static_cast<int>(size.x), static_cast<int>(size.y));
+			if (area.width > 0 && area.height > 0)
+			{
+				rect.left = std::max(area.left, 0);
+				rect.top = std::max(area.top, 0);
+				rect.width = std::min(area.width, static_cast<int>(size.x) - rect.left);
+				rect.height = std::min(area.height, static_cast<int>(size.y) - rect.top);
+			}
+			if (rect.width <= 0 || rect.height <= 0)
+				return texture.getSize() == sf::Vector2u(0, 0);
+			if (texture.getSize() != sf::Vector2u(static_cast<unsigned int>(rect.width), static_cast<unsigned int>(rect.height)))
+				return false;
+			sf::Image contents = texture.copyToImage();
+			const sf::Uint8 * expected = image.getPixelsPtr();
+			const sf::Uint8 * actual = contents.getPixelsPtr();
+			if (expected == nullptr || actual == nullptr)
+				return expected == actual;
+			std::size_t row = static_cast<std::size_t>(rect.width) * 4;
+			for (int y = 0; y < rect.height; ++y)
+			{
+				const sf::Uint8 * source = expected + (static_cast<std::size_t>(rect.top + y) * size.x + static_cast<std::size_t>(rect.left)) * 4;
+				if (std::memcmp(source, actual + static_cast<std::size_t>(y) * row, row) != 0)
+					return false;
+			}
+			return true;
+		}
+		static void          unregister(Registry & registry, const sf::Texture * texture)
+		{
+			// Forget a texture that is being destroyed
+			auto entry = registry.entries.find(texture);
+			if (entry == registry.entries.end())
+				return;
+			Key key = entry->second.key;
+			auto found = registry.textures.find(key);
+			if (found != registry.textures.end() && found->second.expired())
+				registry.textures.erase(found);
+			registry.entries.erase(entry);
+			// Paths that decoded to these contents are forgotten with the last texture that holds them
+			for (const auto & other : registry.entries)
+				if (other.second.key.hash == key.hash && other.second.key.size == key.size)
+					return;
+			for (auto path = registry.paths.begin(); path != registry.paths.end();)
+			{
+				if (path->second.first == key.hash && path->second.second == key.size)
+					path = registry.paths.erase(path);
+				else
+					++path;
+			}
+		}
+		std::shared_ptr<sf::Texture> find(const Key & key)
+		{
+			// Returns the living texture with a key, or nullptr
+			auto entry = m_registry->textures.find(key);
+			if (entry == m_registry->textures.end())
+				return nullptr;
+			std::shared_ptr<sf::Texture> texture = entry->second.lock();
+			if (texture)
+				++m_reuses;
+			return texture;
+		}
+	};
+}
@@ -18,6 +18,8 @@ namespace sfext
 	{
 	protected:
 		sf::Texture texture;
+		const sf::Texture * sharedTexture = nullptr; // Texture owned by someone else, drawn instead of the copy when set
+		sf::IntRect textureRect; // Part of the texture to stretch over the entity, empty to tile the texture in pixels
 	public:
 		// Constructors
 		TexturedEntity() : Entity()
@@ -26,6 +28,17 @@ namespace sfext
 		TexturedEntity(const Collidable & collidable, const sf::Texture & txt, const sf::Vector2f & velocity = sf::Vector2f()) : Entity(collidable, velocity), texture(txt)
 		{
 		}
+		TexturedEntity(const Collidable & collidable, const sf::Texture * txt, const sf::Vector2f & velocity = sf::Vector2f()) : Entity(collidable, velocity), sharedTexture(txt)
+		{
+			// Draws with a texture that is owned elsewhere (e.g. by a TextureHandler) instead of a copy of it
+			// Entities that share a texture end up in the same batch when an EntityHandler draws them
+			updateVertices();
+		}
+		TexturedEntity(const Collidable & collidable, const sf::Texture * txt, const sf::IntRect & rect, const sf::Vector2f & velocity = sf::Vector2f()) : Entity(collidable, velocity), sharedTexture(txt), textureRect(rect)
+		{
+			// Stretches part of a shared texture over the entity, e.g. the region of a TextureAtlas page that belongs to an alias
+			updateVertices();
+		}
 		TexturedEntity(const Collidable & collidable, const sf::Sprite & sprite, const sf::Vector2f & velocity = sf::Vector2f()) : Entity(collidable, velocity)
 		{
 			setTexture(sprite);
@@ -41,31 +54,66 @@ namespace sfext
 		// Accessors
 		const sf::Texture & getTexture() const
 		{
-			return texture;
+			return sharedTexture ? *sharedTexture : texture;
+		}
+		virtual const sf::Texture * getBatchTexture() const
+		{
+			return &getTexture();
 		}
 		// Mutators
 		void setTexture (const sf::Texture & txt)
 		{
 			texture = txt;
+			sharedTexture = nullptr;
+			updateVertices();
+		}
+		void setTexture (const sf::Texture * txt)
+		{
+			// The texture is not copied, so it has to outlive the entity
+			sharedTexture = txt;
+			textureRect = sf::IntRect();
+			updateVertices();
+		}
+		void setTexture (const sf::Texture * txt, const sf::IntRect & rect)
+		{
+			// Stretch part of a shared texture over the entity, e.g. an alias's region of a TextureAtlas page
+			sharedTexture = txt;
+			textureRect = rect;
+			updateVertices();
 		}
 		void setTexture (const sf::Image & image)
 		{
 			texture.loadFromImage(image);
+			sharedTexture = nullptr;
+			updateVertices();
 		}
 		void setTexture (const sf::Sprite & sprite)
 		{
 			if (sprite.getTexture())
 			{
 				texture = *(sprite.getTexture());
+				sharedTexture = nullptr;
+				updateVertices();
 			}
 		}
 		void setRepeated(bool repeated)
 		{
+			// Only changes the entity's own copy, a shared texture has to be changed through its owner
 			texture.setRepeated(repeated);
 		}
 		// Utilities
 		virtual void updateVertices()
 		{
+			if (sharedTexture && textureRect.width != 0 && textureRect.height != 0)
+			{
+				sf::Vector2f topLeft(static_cast<float>(textureRect.left), static_cast<float>(textureRect.top));
+				sf::Vector2f size(static_cast<float>(textureRect.width), static_cast<float>(textureRect.height));
+				m_vertices[0] = sf::Vertex(m_collidable.getPosition(), topLeft);
+				m_vertices[1] = sf::Vertex(m_collidable.getPosition() + sf::Vector2f(m_collidable.getDimensions().x, 0.f), topLeft + sf::Vector2f(size.x, 0.f));
+				m_vertices[2] = sf::Vertex(m_collidable.getPosition() + m_collidable.getDimensions(), topLeft + size);
+				m_vertices[3] = sf::Vertex(m_collidable.getPosition() + sf::Vector2f(0.f, m_collidable.getDimensions().y), topLeft + sf::Vector2f(0.f, size.y));
+				return;
+			}
 			m_vertices[0] = sf::Vertex(m_collidable.getPosition(), sf::Vector2f(0.f, 0.f));
 			m_vertices[1] = sf::Vertex(m_collidable.getPosition() + sf::Vector2f(m_collidable.getDimensions().x, 0.f), sf::Vector2f(m_collidable.getDimensions().x, 0.f));
 			m_vertices[2] = sf::Vertex(m_collidable.getPosition() + m_collidable.getDimensions(), m_collidable.getDimensions());
@@ -73,7 +121,7 @@ namespace sfext
 		}
 		virtual void draw(sf::RenderTarget & target, sf::RenderStates states = sf::RenderStates::Default) const
 		{
-			states.texture = &texture;
+			states.texture = &getTexture();
 			target.draw(m_vertices, states);
 		}
 	};
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstddef>
+
+#include <SFML/Config.hpp>
+#include <SFML/Graphics/Drawable.hpp>
+#include <SFML/Graphics/RenderTarget.hpp>
+#include <SFML/Graphics/VertexArray.hpp>
+
+#if SFML_VERSION_MAJOR > 2 || (SFML_VERSION_MAJOR == 2 && SFML_VERSION_MINOR >= 5)
+#define SFEXT_HAS_VERTEX_BUFFER
+#include <SFML/Graphics/VertexBuffer.hpp>
+#endif
+
+// The VertexBatch class is a persistent vertex array that is meant to be rewritten in place every frame.
+
+// Instead of building a new sf::VertexArray and appending to it one vertex at a time, the owner sizes the batch once
+// per frame with resize() and writes the vertices directly through the returned pointer. The memory is kept between
+// frames, so once the batch has reached its working size drawing it does not allocate.
+
+// When SFML 2.5 or newer is available the batch can also be streamed into an sf::VertexBuffer, which keeps a copy of
+// the vertices on the GPU. The buffer is only uploaded to when the vertices have changed since the last draw.
+
+// TODO: tests
+
+namespace sfext
+{
+	class VertexBatch final : public sf::Drawable
+	{
+	private:
+		sf::VertexArray m_vertices;
+#if defined(SFEXT_HAS_VERTEX_BUFFER)
+		mutable sf::VertexBuffer m_buffer;
+		mutable bool m_modified;
+		bool m_useVertexBuffer;
+#endif
+	public:
+		// Constructors
+		explicit VertexBatch(sf::PrimitiveType type = sf::PrimitiveType::Points) : m_vertices(type, 0U)
+#if defined(SFEXT_HAS_VERTEX_BUFFER)
+			, m_buffer(type, sf::VertexBuffer::Stream), m_modified(true), m_useVertexBuffer(false)
+#endif
+		{
+		}
+		// Destructor
+		~VertexBatch()
+		{
+		}
+		// Accessors
+		std::size_t       size            () const
+		{
+			// Returns the number of vertices in the batch
+			return m_vertices.getVertexCount();
+		}
+		sf::PrimitiveType getPrimitiveType() const
+		{
+			// Returns the type of primitive that the vertices make up
+			return m_vertices.getPrimitiveType();
+		}
+		bool              usesVertexBuffer() const
+		{
+			// Returns true if the batch is streamed into an sf::VertexBuffer when it is drawn
+#if defined(SFEXT_HAS_VERTEX_BUFFER)
+			return m_useVertexBuffer;
+#else
+			return false;
+#endif
+		}
+		// Mutators
+		void         setPrimitiveType(sf::PrimitiveType type)
+		{
+			// Change the type of primitive that the vertices make up
+			m_vertices.setPrimitiveType(type);
+#if defined(SFEXT_HAS_VERTEX_BUFFER)
+			m_buffer.setPrimitiveType(type);
+#endif
+		}
+		bool         setUseVertexBuffer(bool use)
+		{
+			// Opt in to (or out of) streaming the batch into a GPU resident vertex buffer
+			// Returns false if vertex buffers are not supported, in which case the vertex array is drawn directly
+#if defined(SFEXT_HAS_VERTEX_BUFFER)
+			if (use && !sf::VertexBuffer::isAvailable())
+				return false;
+			m_useVertexBuffer = use;
+			m_modified = true;
+			return true;
+#else
+			return !use;
+#endif
+		}
+		sf::Vertex * resize          (std::size_t count)
+		{
+			// Set the number of vertices in the batch and return a pointer to the first one so it can be written in place
+			// Shrinking the batch keeps its memory, so a batch that is resized every frame only allocates when it grows
+			// Returns nullptr if count is 0
+			m_vertices.resize(count);
+			return getVertices();
+		}
+		sf::Vertex * getVertices     ()
+		{
+			// Returns a pointer to the first vertex in the batch, or nullptr if the batch is empty
+			// The vertices are assumed to be modified through this pointer
+#if defined(SFEXT_HAS_VERTEX_BUFFER)
+			m_modified = true;
+#endif
+			return m_vertices.getVertexCount() ? &m_vertices[0] : nullptr;
+		}
+		// Utilities
+		void draw(sf::RenderTarget & target, sf::RenderStates states = sf::RenderStates::Default) const
+		{
+			// Draw every vertex in the batch with a single draw call
+			std::size_t count = m_vertices.getVertexCount();
+			if (count == 0)
+				return;
+#if defined(SFEXT_HAS_VERTEX_BUFFER)
+			if (m_useVertexBuffer)
+			{
+				if (m_modified)
+				{
+					// Grow the GPU buffer geometrically so that it is not recreated every time the batch grows
+					if (m_buffer.getVertexCount() < count)
+						m_buffer.create(count + count / 2);
+					m_buffer.update(&m_vertices[0], count, 0);
+					m_modified = false;
+				}
+				target.draw(m_buffer, 0, count, states);
+				return;
+			}
+#endif
+			target.draw(m_vertices, states);
+		}
+	};
+}
\ No newline at end of file
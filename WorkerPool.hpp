@@ -0,0 +1,174 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// The WorkerPool class keeps a set of worker threads alive so that data-parallel loops can be split across cores
+// without creating threads every frame.
+
+// The only operation is parallelFor, which cuts a range of indices into fixed-size chunks and blocks until every chunk
+// has been processed. The calling thread works on chunks as well. Chunk boundaries only depend on the range and the
+// chunk size, never on the number of threads, so work that writes to disjoint ranges produces the same results
+// regardless of how many workers the pool has.
+
+// If a chunk throws, the chunks that have not started yet are skipped, and parallelFor rethrows the first exception
+// once the chunks that were already running have finished.
+
+// The task can be any callable and is called through a plain function pointer, so parallelFor never allocates, however
+// much a lambda captures. A pool runs one parallelFor at a time. A parallelFor that is started while another one is
+// running, from inside a task or from another thread, runs all of its chunks on the calling thread instead.
+
+// TODO: tests
+
+namespace sfext
+{
+	const std::size_t WorkerChunkSize = 4096; // Default number of elements that a worker thread processes at a time
+
+	class WorkerPool final
+	{
+	private:
+		std::vector<std::thread> m_threads;
+		std::mutex m_mutex;
+		std::condition_variable m_wake;
+		std::condition_variable m_done;
+		const void * m_task;
+		void (*m_runTask)(const void *, std::size_t, std::size_t); // Calls the task behind m_task with a chunk
+		bool m_running;
+		std::size_t m_count;
+		std::size_t m_chunkSize;
+		std::size_t m_nextChunk;
+		std::size_t m_chunkCount;
+		std::size_t m_finishedChunks;
+		std::size_t m_generation;
+		std::exception_ptr m_exception;
+		bool m_stopping;
+	public:
+		// Constructors
+		explicit WorkerPool(unsigned int threads = std::thread::hardware_concurrency()) : m_task(nullptr), m_runTask(nullptr), m_running(false), m_count(0), m_chunkSize(1), m_nextChunk(0), m_chunkCount(0), m_finishedChunks(0), m_generation(0), m_stopping(false)
+		{
+			// The calling thread also does work, so one less worker than the requested thread count is started
+			for (unsigned int i = 1; i < threads; ++i)
+				m_threads.emplace_back([this]() { work(); });
+		}
+		WorkerPool(const WorkerPool &) = delete;
+		WorkerPool & operator = (const WorkerPool &) = delete;
+		// Destructor
+		~WorkerPool()
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_stopping = true;
+			}
+			m_wake.notify_all();
+			for (std::thread & thread : m_threads)
+				thread.join();
+		}
+		// Accessors
+		unsigned int getThreadCount() const
+		{
+			// Returns the number of threads that work on a parallelFor, including the calling thread
+			return static_cast<unsigned int>(m_threads.size()) + 1;
+		}
+		// Utilities
+		template <typename Task>
+		void parallelFor(std::size_t count, std::size_t chunkSize, const Task & task)
+		{
+			// Call task(first, last) for consecutive chunks [first, last) covering [0, count), and wait for all of them
+			// Chunks may run concurrently and in any order, so each chunk must only write to its own data
+			// Rethrows the first exception that a chunk threw, after the other running chunks have finished
+			if (count == 0)
+				return;
+			chunkSize = std::max<std::size_t>(chunkSize, 1);
+			std::size_t chunks = (count + chunkSize - 1) / chunkSize;
+			bool busy = true;
+			if (!m_threads.empty() && chunks > 1)
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				busy = m_running;
+				m_running = true;
+			}
+			if (busy)
+			{
+				for (std::size_t first = 0; first < count; first += chunkSize)
+					task(first, std::min(first + chunkSize, count));
+				return;
+			}
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_task = &task; // The task outlives the call because parallelFor waits for every chunk
+				m_runTask = [](const void * function, std::size_t first, std::size_t last) { (*static_cast<const Task *>(function))(first, last); };
+				m_count = count;
+				m_chunkSize = chunkSize;
+				m_nextChunk = 0;
+				m_chunkCount = chunks;
+				m_finishedChunks = 0;
+				++m_generation;
+			}
+			m_wake.notify_all();
+			runChunks();
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_done.wait(lock, [this]() { return m_finishedChunks == m_chunkCount; });
+			m_task = nullptr;
+			m_running = false;
+			std::exception_ptr exception;
+			std::swap(exception, m_exception);
+			lock.unlock();
+			if (exception)
+				std::rethrow_exception(exception);
+		}
+	private:
+		void runChunks()
+		{
+			// Claim and run chunks until there are none left
+			std::unique_lock<std::mutex> lock(m_mutex);
+			while (m_nextChunk < m_chunkCount)
+			{
+				std::size_t chunk = m_nextChunk++;
+				std::size_t first = chunk * m_chunkSize;
+				std::size_t last = std::min(first + m_chunkSize, m_count);
+				lock.unlock();
+				std::exception_ptr exception;
+				try
+				{
+					m_runTask(m_task, first, last);
+				}
+				catch (...)
+				{
+					exception = std::current_exception();
+				}
+				lock.lock();
+				if (exception)
+				{
+					// Keep the first exception and cancel the chunks that nobody has claimed yet
+					if (!m_exception)
+						m_exception = exception;
+					m_finishedChunks += m_chunkCount - m_nextChunk;
+					m_nextChunk = m_chunkCount;
+				}
+				if (++m_finishedChunks == m_chunkCount)
+					m_done.notify_all();
+			}
+		}
+		void work()
+		{
+			// Worker thread loop: sleep until a new parallelFor starts, then help with its chunks
+			std::size_t generation = 0;
+			while (true)
+			{
+				{
+					std::unique_lock<std::mutex> lock(m_mutex);
+					m_wake.wait(lock, [this, generation]() { return m_stopping || m_generation != generation; });
+					if (m_stopping)
+						return;
+					generation = m_generation;
+				}
+				runChunks();
+			}
+		}
+	};
+}
\ No newline at end of file